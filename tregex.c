@@ -1,26 +1,304 @@
 #include "stdio.h"
 #include "stdlib.h"
 #include "string.h"
+#include "time.h"
+#include "setjmp.h"
+#include "stdint.h"
+#include "limits.h"
 
-enum {NORMAL, START, END, EMPTY, NUMBERS, LETTERS, ANYTHING, SYMBOL};
+#if !defined(_WIN32)
+#include "pthread.h"
+#endif
+
+#if defined(__AVX2__)
+#include "immintrin.h"
+#elif defined(__SSE2__)
+#include "emmintrin.h"
+#endif
+
+enum {NORMAL, START, END, EMPTY, NUMBERS, LETTERS, ANYTHING, SYMBOL, OPEN, CLOSE, RANGE, FOLDED};
+enum {FLAG_UTF8 = 1, FLAG_IGNORE_CASE = 2};
+enum {NO_MATCH, MATCH, TIMEOUT, TOO_LONG, NO_MEMORY};
+
+/**
+    Allocator used by all of TRegex memory, could be changed with tRegexSetAllocator
+*/
+void *(*tRegexAllocFunc)(size_t) = malloc;
+void (*tRegexFreeFunc)(void*) = free;
+
+/**
+    Process-wide memory accounting, updated atomically so TRegex could be compiled from many thread
+    tRegexMemoryInUse : bytes currently allocated by TRegex
+    tRegexMemoryMaxUsed : highest tRegexMemoryInUse ever reached
+    tRegexMemoryBudget : maximum bytes TRegex could use, 0 if unlimited (allocation going over it fail)
+*/
+size_t tRegexMemoryInUse = 0;
+size_t tRegexMemoryMaxUsed = 0;
+size_t tRegexMemoryBudget = 0;
+
+/**
+    Header placed before every allocated block to remember it's size
+    @attribute info.size : size of the block in bytes
+    @attribute info.slot : index of the block in compile guard's block list (only valid while that compile run)
+*/
+typedef union TRMemoryHeader
+{
+    struct
+    {
+        size_t size;
+        size_t slot;
+    } info;
+    long double align;
+    void *pointer;
+} TRMemoryHeader;
+
+/**
+    Guard of compile running on this thread, every block allocated while compiling is remembered
+    so failed compile could free all of them and jump back to tRegexCompile
+    @attribute active : 1 if a compile is running on this thread
+    @attribute failure : where to jump when allocation failed
+    @attribute blocks : block allocated while compiling (NULL if already freed)
+    @attribute count : number of block in blocks
+    @attribute capacity : capacity of blocks
+*/
+typedef struct TRCompileGuard
+{
+    int active;
+    jmp_buf failure;
+    void **blocks;
+    size_t count;
+    size_t capacity;
+} TRCompileGuard;
+
+__thread TRCompileGuard trCompileGuard;
+
+/**
+    Function to handle failed allocation, jump back to tRegexCompile if compiling on this thread
+    @return NULL if not compiling
+*/
+void *trMemoryFail()
+{
+    if (trCompileGuard.active == 1)
+    {
+        longjmp(trCompileGuard.failure, 1);
+    }
+    return NULL;
+}
+
+/**
+    Function to remember block allocated while compiling
+    @param header : header of allocated block
+    @return 1 if remembered, 0 if block list could not grow
+*/
+int trCompileGuardTrack(TRMemoryHeader *header)
+{
+    if (trCompileGuard.count >= trCompileGuard.capacity)
+    {
+        size_t capacity = trCompileGuard.capacity == 0 ? 64 : trCompileGuard.capacity * 2;
+        void **blocks = (void**)tRegexAllocFunc(sizeof(void*) * capacity);
+        if (blocks == NULL)
+        {
+            return 0;
+        }
+        if (trCompileGuard.count > 0)
+        {
+            memcpy(blocks, trCompileGuard.blocks, sizeof(void*) * trCompileGuard.count);
+        }
+        tRegexFreeFunc(trCompileGuard.blocks);
+        trCompileGuard.blocks = blocks;
+        trCompileGuard.capacity = capacity;
+    }
+    header->info.slot = trCompileGuard.count;
+    trCompileGuard.blocks[trCompileGuard.count] = header + 1;
+    trCompileGuard.count += 1;
+    return 1;
+}
+
+/**
+    Function to allocate memory with accounting
+    @param size : size in bytes
+    @return pointer to allocated memory, NULL if allocator failed or memory budget would be exceeded
+*/
+void *trMemoryAlloc(size_t size)
+{
+    if (size > SIZE_MAX - sizeof(TRMemoryHeader))
+    {
+        return trMemoryFail();
+    }
+    // counted first so thread allocating at the same time couldn't both fit in the last part of budget
+    size_t inUse = __atomic_add_fetch(&tRegexMemoryInUse, sizeof(TRMemoryHeader) + size, __ATOMIC_RELAXED);
+    if (tRegexMemoryBudget != 0 && inUse > tRegexMemoryBudget)
+    {
+        __atomic_sub_fetch(&tRegexMemoryInUse, sizeof(TRMemoryHeader) + size, __ATOMIC_RELAXED);
+        return trMemoryFail();
+    }
+    TRMemoryHeader *header = (TRMemoryHeader*)tRegexAllocFunc(sizeof(TRMemoryHeader) + size);
+    if (header == NULL)
+    {
+        __atomic_sub_fetch(&tRegexMemoryInUse, sizeof(TRMemoryHeader) + size, __ATOMIC_RELAXED);
+        return trMemoryFail();
+    }
+    header->info.size = size;
+    header->info.slot = SIZE_MAX;
+    if (trCompileGuard.active == 1 && trCompileGuardTrack(header) == 0)
+    {
+        __atomic_sub_fetch(&tRegexMemoryInUse, sizeof(TRMemoryHeader) + size, __ATOMIC_RELAXED);
+        tRegexFreeFunc(header);
+        return trMemoryFail();
+    }
+    size_t maxUsed = __atomic_load_n(&tRegexMemoryMaxUsed, __ATOMIC_RELAXED);
+    while (inUse > maxUsed && __atomic_compare_exchange_n(&tRegexMemoryMaxUsed, &maxUsed, inUse, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED) == 0)
+    {
+    }
+    return header + 1;
+}
+
+/**
+    Function to allocate zeroed memory with accounting
+    @param count : number of element
+    @param size : size of one element in bytes
+    @return pointer to allocated memory, NULL if allocator failed or count * size overflow
+*/
+void *trMemoryCalloc(size_t count, size_t size)
+{
+    if (size != 0 && count > SIZE_MAX / size)
+    {
+        return trMemoryFail();
+    }
+    void *memory = trMemoryAlloc(count * size);
+    if (memory != NULL)
+    {
+        memset(memory, 0, count * size);
+    }
+    return memory;
+}
+
+/**
+    Function to free memory allocated by trMemoryAlloc
+    @param memory : memory that will be freed (could be NULL)
+*/
+void trMemoryFree(void *memory)
+{
+    if (memory == NULL)
+    {
+        return;
+    }
+    TRMemoryHeader *header = (TRMemoryHeader*)memory - 1;
+    if (trCompileGuard.active == 1 && header->info.slot < trCompileGuard.count && trCompileGuard.blocks[header->info.slot] == memory)
+    {
+        trCompileGuard.blocks[header->info.slot] = NULL;
+    }
+    __atomic_sub_fetch(&tRegexMemoryInUse, sizeof(TRMemoryHeader) + header->info.size, __ATOMIC_RELAXED);
+    tRegexFreeFunc(header);
+}
+
+/**
+    Function to check if more memory could be allocated without going over the budget
+    @param size : size in bytes that want to be allocated
+    @return 1 if it fit in the budget, 0 if not
+*/
+int tRegexMemoryFits(size_t size)
+{
+    return tRegexMemoryBudget == 0 || __atomic_load_n(&tRegexMemoryInUse, __ATOMIC_RELAXED) + size <= tRegexMemoryBudget;
+}
+
+/**
+    Function to change allocator used by TRegex, must be called before any TRegex or TRDArray created,
+    allocator must be thread safe if tRegexCompileMany is used with more than one thread
+    @param allocFunc : function to allocate memory (like malloc)
+    @param freeFunc : function to free memory (like free)
+*/
+void tRegexSetAllocator(void *(*allocFunc)(size_t), void (*freeFunc)(void*))
+{
+    tRegexAllocFunc = allocFunc;
+    tRegexFreeFunc = freeFunc;
+}
+
+/**
+    Function to set process-wide memory budget
+    @param budget : maximum bytes, 0 for unlimited
+*/
+void tRegexSetMemoryBudget(size_t budget)
+{
+    tRegexMemoryBudget = budget;
+}
+
+/**
+    Function to get bytes currently allocated by all TRegex in process
+    @return bytes in use
+*/
+size_t tRegexMemoryTotal()
+{
+    return __atomic_load_n(&tRegexMemoryInUse, __ATOMIC_RELAXED);
+}
+
+/**
+    Function to get highest bytes ever allocated by all TRegex in process
+    @return highest bytes in use
+*/
+size_t tRegexMemoryPeak()
+{
+    return __atomic_load_n(&tRegexMemoryMaxUsed, __ATOMIC_RELAXED);
+}
 
 /**
     This is for regex-graph's node, containing current state char and nextState (array)
-    @attribute data : char data for this state
+    @attribute data : char data for this state (lowest byte for RANGE, lowercase letter for FOLDED)
+    @attribute dataEnd : highest byte for RANGE
     @attribute size : size of array for next state
     @attribute capacity : capacity of array for next state
     @attribute nextState : dynamic array for next state (pointer)
+    @attribute type : type of this state (NORMAL, EMPTY, LETTERS, ...)
+    @attribute visited : mark used by graph traversal
+    @attribute id : index of this state in compiled regex state list
+    @attribute group : group number of OPEN and CLOSE
+    @attribute hits : how many times this state visited when profiling
+    @attribute edgeHits : how many times each next state taken when profiling (NULL until first hit)
+    @attribute edgeMatches : how many times each next state lead to match when profiling (NULL until first match)
 */
 typedef struct TRDArray
 {
     char data;
+    char dataEnd;
     int size;
     int capacity;
     struct TRDArray **nextState;
     int type;
     int visited;
+    int id;
+    int group;
+    long hits;
+    long *edgeHits;
+    long *edgeMatches;
 } TRDArray;
 
+/**
+    1 if matching should count hits of every state and edge, 0 if not,
+    read and written atomically since matching may run on many threads
+*/
+int tRegexProfiling = 0;
+
+/**
+    Function to check if profiling is on
+    @return 1 if matching should count hits, 0 if not
+*/
+int trProfilingEnabled()
+{
+    return __atomic_load_n(&tRegexProfiling, __ATOMIC_RELAXED);
+}
+
+/**
+    Maximum size (in bit) of visited bitmap, tRegexComparePattern only use bit state engine if
+    number of state times (length of string + 1) not bigger than this
+*/
+long tRegexBitStateMaxBits = 256 * 1024;
+
+/**
+    Maximum recursion depth of backtracking, deeper matching is given to state set simulation
+    so C stack never run out
+*/
+int tRegexBacktrackMaxDepth = 4096;
+
 /**
     function to get size of TRDArray-next-state-array
     @param array : current state node
@@ -56,20 +334,76 @@ int trDArrayGetType(TRDArray *array)
     return array->type;
 }
 
+/**
+    function to get group number of OPEN or CLOSE state
+    @param array : current state node
+    @return group number of the current state
+*/
+int trDArrayGetGroup(TRDArray *array)
+{
+    return array->group;
+}
+
+/**
+    function to check if state doesn't consume character (START, EMPTY, OPEN and CLOSE of group)
+    @param array : current state node
+    @return 1 if state doesn't consume character, 0 if it does
+*/
+int trDArrayIsEpsilon(TRDArray *array)
+{
+    int type = trDArrayGetType(array);
+    return type == EMPTY || type == START || type == OPEN || type == CLOSE;
+}
+
+/**
+    Function to check if state could consume one character
+    @param state : consuming state (NORMAL, NUMBERS, LETTERS, ANYTHING, RANGE, FOLDED)
+    @param c : character to be consumed
+    @return 1 if state consume c, 0 if not
+*/
+int trDArrayMatchByte(TRDArray *state, char c)
+{
+    switch (trDArrayGetType(state))
+    {
+        case NORMAL: return trDArrayGetData(state) == c;
+        case NUMBERS: return c >= 48 && c <= 57;
+        case LETTERS: return (c >= 65 && c <= 90) || (c >= 97 && c <= 122) || c == '_';
+        case ANYTHING: return 1;
+        case RANGE: return (unsigned char)c >= (unsigned char)trDArrayGetData(state) && (unsigned char)c <= (unsigned char)state->dataEnd;
+        case FOLDED: return (c | 0x20) == trDArrayGetData(state);
+    }
+    return 0;
+}
+
 /**
     function to initialize TRDArray with state data
     @param data : data of current state
-    @return the initialized of TRDArray
+    @return the initialized of TRDArray, NULL if allocator failed
 */
 TRDArray *trDArrayInit(char data, int type)
 {
-    TRDArray *trDArray = (TRDArray*)malloc(sizeof(TRDArray));
+    TRDArray *trDArray = (TRDArray*)trMemoryAlloc(sizeof(TRDArray));
+    if (trDArray == NULL)
+    {
+        return NULL;
+    }
     trDArray->data = data;
+    trDArray->dataEnd = data;
     trDArray->size = 0;
     trDArray->capacity = 2;
-    trDArray->nextState = (TRDArray**)malloc(sizeof(TRDArray*) * trDArrayGetCapacity(trDArray));
+    trDArray->nextState = (TRDArray**)trMemoryAlloc(sizeof(TRDArray*) * trDArrayGetCapacity(trDArray));
+    if (trDArray->nextState == NULL)
+    {
+        trMemoryFree(trDArray);
+        return NULL;
+    }
     trDArray->visited = 0;
     trDArray->type = type;
+    trDArray->id = 0;
+    trDArray->group = 0;
+    trDArray->hits = 0;
+    trDArray->edgeHits = NULL;
+    trDArray->edgeMatches = NULL;
     return trDArray;
 }
 
@@ -88,29 +422,84 @@ TRDArray* trDArrayGetElement(TRDArray *trDarray, int index)
     return trDarray->nextState[index];
 }
 
+/**
+    function to copy edge counter to bigger array, old counter is not freed
+    @param counter : old counter (could be NULL)
+    @param size : number of counter used
+    @param capacity : capacity of new counter
+    @return new counter, NULL if old counter is NULL or allocator failed
+*/
+long *trDArrayGrowCounter(long *counter, int size, int capacity)
+{
+    if (counter == NULL)
+    {
+        return NULL;
+    }
+    long *newCounter = (long*)trMemoryCalloc(capacity, sizeof(long));
+    if (newCounter != NULL)
+    {
+        memcpy(newCounter, counter, sizeof(long) * size);
+    }
+    return newCounter;
+}
+
+/**
+    function to make capacity of next-state-array (and it's edge counter) at least capacity,
+    array is not changed if allocator failed
+    @param array : array that will be grown
+    @param capacity : minimum capacity
+    @return 1 if array has the capacity, 0 if allocator failed
+*/
+int trDArrayReserve(TRDArray *array, int capacity)
+{
+    if (capacity <= trDArrayGetCapacity(array))
+    {
+        return 1;
+    }
+
+    TRDArray **newArrayNextState = (TRDArray**)trMemoryAlloc(sizeof(TRDArray*) * capacity);
+    long *newEdgeHits = trDArrayGrowCounter(array->edgeHits, trDArrayGetSize(array), capacity);
+    long *newEdgeMatches = trDArrayGrowCounter(array->edgeMatches, trDArrayGetSize(array), capacity);
+    if (newArrayNextState == NULL || (array->edgeHits != NULL && newEdgeHits == NULL) || (array->edgeMatches != NULL && newEdgeMatches == NULL))
+    {
+        trMemoryFree(newArrayNextState);
+        trMemoryFree(newEdgeHits);
+        trMemoryFree(newEdgeMatches);
+        return 0;
+    }
+
+    for (int i = 0; i < trDArrayGetSize(array); i++)
+    {
+        newArrayNextState[i] = trDArrayGetElement(array, i);
+    }
+    trMemoryFree(array->nextState);
+    trMemoryFree(array->edgeHits);
+    trMemoryFree(array->edgeMatches);
+    array->nextState = newArrayNextState;
+    array->edgeHits = newEdgeHits;
+    array->edgeMatches = newEdgeMatches;
+    array->capacity = capacity;
+    return 1;
+}
+
 /**
     function to push new next state to current state next-state-array
     @param array : the current state that will added a new next state
     @param newData : new next state that will be pushed
+    @return 1 if pushed, 0 if array is full and allocator failed (array not changed)
 */
-void trDArrayPush(TRDArray *array, TRDArray* newData)
+int trDArrayPush(TRDArray *array, TRDArray* newData)
 {
 
     // if array is full, then create the copy with bigger capacity (3/2 times bigger than before)
-    if (array->size >= array->capacity)
+    if (array->size >= array->capacity && trDArrayReserve(array, trDArrayGetCapacity(array) * 3 / 2) == 0)
     {
-        array->capacity = trDArrayGetCapacity(array) * 3 / 2;
-        TRDArray **newArrayNextState = (TRDArray**)malloc(sizeof(TRDArray*) * trDArrayGetCapacity(array));
-        for (int i = 0; i < trDArrayGetSize(array); i++)
-        {
-            newArrayNextState[i] = trDArrayGetElement(array, i);
-        }
-        free(array->nextState);
-        array->nextState = newArrayNextState;
+        return 0;
     }
 
     array->nextState[trDArrayGetSize(array)] = newData;
     array->size += 1;
+    return 1;
 }
 
 /**
@@ -125,6 +514,28 @@ void trDArrayPop(TRDArray *trDArray)
     }
 }
 
+/**
+    Function to remove element at specific index of next-state-array, element after it shifted to the left
+    @param trDArray : array that it's element will be removed
+    @param index : index of element to be removed
+*/
+void trDArrayRemove(TRDArray *trDArray, int index)
+{
+    for (int i = index; i + 1 < trDArrayGetSize(trDArray); i++)
+    {
+        trDArray->nextState[i] = trDArray->nextState[i + 1];
+        if (trDArray->edgeHits != NULL)
+        {
+            trDArray->edgeHits[i] = trDArray->edgeHits[i + 1];
+        }
+        if (trDArray->edgeMatches != NULL)
+        {
+            trDArray->edgeMatches[i] = trDArray->edgeMatches[i + 1];
+        }
+    }
+    trDArrayPop(trDArray);
+}
+
 /**
     Function to empty next-state-array
     @param trDArray : array that will be emptied
@@ -141,25 +552,39 @@ void trDArrayMakeEmpty(TRDArray *trDArray)
     Function to insert all element of any next-state-array to other next-state-array
     @param destination : destination of insertion
     @param source : array that it's element will be inserted to other array
+    @return 1 if all inserted, 0 if allocator failed (destination not changed)
 */
-void trDArrayInsertAll(TRDArray *destionaton, TRDArray *source)
+int trDArrayInsertAll(TRDArray *destionaton, TRDArray *source)
 {
+    if (trDArrayReserve(destionaton, trDArrayGetSize(destionaton) + trDArrayGetSize(source)) == 0)
+    {
+        return 0;
+    }
     for (int i = 0; i < trDArrayGetSize(source); i++)
     {
         trDArrayPush(destionaton, trDArrayGetElement(source, i));
     }
+    return 1;
 }
 
 
 /**
     Free the current graph node
-    @param garbage : node that will be freed
+    @param garbage : node that will be freed (could be NULL)
 */
 void trDArrayDelete(TRDArray *garbage)
 {
-    free(garbage->nextState);
+    if (garbage == NULL)
+    {
+        return;
+    }
+    trMemoryFree(garbage->nextState);
     garbage->nextState = NULL;
-    free(garbage);
+    trMemoryFree(garbage->edgeHits);
+    garbage->edgeHits = NULL;
+    trMemoryFree(garbage->edgeMatches);
+    garbage->edgeMatches = NULL;
+    trMemoryFree(garbage);
 }
 
 /**
@@ -198,7 +623,7 @@ void trDArrayDeleteAll(TRDArray **root)
             trDArrayDelete(trDArrayGetElement(garbageCollector, i));
         }
     }
-    free(garbageCollector);
+    trDArrayDelete(garbageCollector);
     *root = NULL;
 }
 
@@ -216,17 +641,134 @@ void trDArraySetElement(TRDArray *array, TRDArray *newData, int index)
     }
 }
 
+/**
+    Function to get edge counter array of a state, allocating it on first use,
+    when two threads allocate at the same time only one array is kept
+    @param counter : address of edgeHits or edgeMatches of the state
+    @param capacity : capacity of the state next-state-array
+    @return the counter array (NULL if allocation failed)
+*/
+long *trDArrayProfileCounter(long **counter, int capacity)
+{
+    long *current = __atomic_load_n(counter, __ATOMIC_ACQUIRE);
+    if (current != NULL)
+    {
+        return current;
+    }
+    long *fresh = (long*)trMemoryCalloc(capacity, sizeof(long));
+    if (fresh == NULL)
+    {
+        return NULL;
+    }
+    if (__atomic_compare_exchange_n(counter, &current, fresh, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) == 0)
+    {
+        trMemoryFree(fresh);
+        return current;
+    }
+    return fresh;
+}
+
+/**
+    Function to count one hit of edge at specific index of next-state-array
+    @param array : state that own the edge
+    @param index : index of next state that taken
+*/
+void trDArrayHitEdge(TRDArray *array, int index)
+{
+    long *edgeHits = trDArrayProfileCounter(&array->edgeHits, trDArrayGetCapacity(array));
+    if (edgeHits != NULL)
+    {
+        __atomic_fetch_add(&edgeHits[index], 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+    Function to count one match reached through edge at specific index of next-state-array
+    @param array : state that own the edge
+    @param index : index of next state that lead to match
+*/
+void trDArrayMatchEdge(TRDArray *array, int index)
+{
+    long *edgeMatches = trDArrayProfileCounter(&array->edgeMatches, trDArrayGetCapacity(array));
+    if (edgeMatches != NULL)
+    {
+        __atomic_fetch_add(&edgeMatches[index], 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+    Function to count memory used by one node (including it's next-state-array)
+    @param array : node to be counted
+    @return bytes used by the node
+*/
+size_t trDArrayMemoryUsage(TRDArray *array)
+{
+    size_t usage = sizeof(TRMemoryHeader) + sizeof(TRDArray);
+    usage += sizeof(TRMemoryHeader) + sizeof(TRDArray*) * trDArrayGetCapacity(array);
+    if (array->edgeHits != NULL)
+    {
+        usage += sizeof(TRMemoryHeader) + sizeof(long) * trDArrayGetCapacity(array);
+    }
+    if (array->edgeMatches != NULL)
+    {
+        usage += sizeof(TRMemoryHeader) + sizeof(long) * trDArrayGetCapacity(array);
+    }
+    return usage;
+}
+
+/**
+    Function to collect all node of graph into one array, every node get id same as it's index
+    @param root : root of graph
+    @return array containing all node of graph, root at index 0
+*/
+TRDArray *trDArrayCollectAll(TRDArray *root)
+{
+    TRDArray *stateList = trDArrayInit((char)0, EMPTY);
+    trDArrayPush(stateList, root);
+    root->visited = 1;
+    trDArrayDeleteAllFuncRec(stateList, root);
+
+    for (int i = 0; i < trDArrayGetSize(stateList); i++)
+    {
+        trDArrayGetElement(stateList, i)->visited = 0;
+        trDArrayGetElement(stateList, i)->id = i;
+    }
+    return stateList;
+}
+
 /**
     struct for regex
     @attribute code : regular expression string notation
     @attribute compiled : 0 if not compiled, 1 if compiled (compiled means graph already built from string notation)
+    @attribute flags : compile flag (FLAG_UTF8, FLAG_IGNORE_CASE)
     @attribute startingState : start state for graph
+    @attribute stateList : all state of compiled graph indexed by id (NULL if not compiled)
+    @attribute groupCount : number of group, group 0 is whole pattern
+    @attribute onePass : 1 if at every position at most one state could consume next character
+    @attribute minLength : minimum length of string that could match
+    @attribute maxLength : maximum length of string that could match, -1 if unbounded
+    @attribute firstBytes : bitset of character that could be first character of matched string
+    @attribute lastBytes : bitset of character that could be last character of matched string
+    @attribute literal : 1 if pattern only match one string (literalString), 0 if not
+    @attribute literalString : the only string matched if literal is 1
+    @attribute shared : 1 if state is owned by TRegexArena (compiled by tRegexCompileMany), 0 if owned by this regex
 */
 typedef struct TRegex
 {
     char code[255];
     int compiled;
+    int flags;
     TRDArray *startingState;
+    TRDArray *stateList;
+    int groupCount;
+    int onePass;
+    int minLength;
+    int maxLength;
+    unsigned char firstBytes[32];
+    unsigned char lastBytes[32];
+    int literal;
+    char literalString[256];
+    int shared;
 } TRegex;
 
 /**
@@ -238,7 +780,15 @@ TRegex tRegexInitCode(char *code)
 {
     TRegex regex;
     regex.compiled = 0;
+    regex.flags = 0;
     regex.startingState = trDArrayInit(0, EMPTY);
+    regex.stateList = NULL;
+    regex.groupCount = 0;
+    regex.onePass = 0;
+    regex.minLength = 0;
+    regex.maxLength = -1;
+    regex.literal = 0;
+    regex.shared = 0;
     strcpy(regex.code, code);
     return regex;
 }
@@ -251,7 +801,15 @@ TRegex tRegexInit()
 {
     TRegex regex;
     regex.compiled = 0;
+    regex.flags = 0;
     regex.startingState = trDArrayInit(0, START);
+    regex.stateList = NULL;
+    regex.groupCount = 0;
+    regex.onePass = 0;
+    regex.minLength = 0;
+    regex.maxLength = -1;
+    regex.literal = 0;
+    regex.shared = 0;
     strcpy(regex.code, "");
     return regex;
 }
@@ -266,43 +824,121 @@ int tRegexIsCompiled(TRegex *regex)
 }
 
 /**
-    Function to set/change code of TRegex (regex string notation)
+    Function to set/change code of TRegex (regex string notation), if allocator failed starting state
+    is left NULL and made again by tRegexCompile
     @param regex : regex that it's code will be changed
     @param code : new regex string notation
 */
 void tRegexSetCode(TRegex *regex, char *code)
 {
     regex->compiled = 0;
-    trDArrayDeleteAll(&(regex->startingState)); // delete existing graph if already compiled
+    if (regex->shared == 1)
+    {
+        regex->shared = 0; // state is owned by arena, only leave it
+    }
+    else if (regex->stateList != NULL)
+    {
+        // delete existing graph, stateList already hold every state so nothing is allocated
+        for (int i = 0; i < trDArrayGetSize(regex->stateList); i++)
+        {
+            trDArrayDelete(trDArrayGetElement(regex->stateList, i));
+        }
+    }
+    else
+    {
+        trDArrayDelete(regex->startingState); // not compiled, starting state has no next state
+    }
+    if (regex->stateList != NULL)
+    {
+        trDArrayDelete(regex->stateList);
+        regex->stateList = NULL;
+    }
     regex->startingState = trDArrayInit(0, START);
     strcpy(regex->code, code);
 }
 
+/**
+    Function to set compile flag of TRegex, graph is deleted so regex must be compiled again
+    @param regex : regex that it's flag will be changed
+    @param flags : FLAG_UTF8 to make '.' match one UTF-8 character and multi-byte character as one unit,
+                   FLAG_IGNORE_CASE to make letter match both case, combined with |, 0 for none
+*/
+void tRegexSetFlags(TRegex *regex, int flags)
+{
+    char code[255];
+    strcpy(code, regex->code);
+    tRegexSetCode(regex, code);
+    regex->flags = flags;
+}
+
+/**
+    Function to make state for one character of regex's notation, with FLAG_IGNORE_CASE letter become
+    one FOLDED state matching both case instead of (a|A)
+    @param data : character
+    @param flags : compile flag of regex
+    @return the initialized state
+*/
+TRDArray *trDArrayInitCharacter(char data, int flags)
+{
+    if ((flags & FLAG_IGNORE_CASE) != 0 && ((data >= 'a' && data <= 'z') || (data >= 'A' && data <= 'Z')))
+    {
+        return trDArrayInit(data | 0x20, FOLDED);
+    }
+    return trDArrayInit(data, NORMAL);
+}
+
 /**
     Function to decode regex's notation to graph for regex
     @param startState : array to store start state of sub graph
     @param endState : array to store end state of sub graph
     @param list : array that contain all graph state from converted code
     @param pos : index of list to be converted
+    @param groupCount : number of group already found, group numbered by position of it's '('
 */
-void tRegexCompileFuncRec(TRDArray *startState, TRDArray *endState, TRDArray *list, int *pos)
+void tRegexCompileFuncRec(TRDArray *startState, TRDArray *endState, TRDArray *list, int *pos, int *groupCount)
 {
 //    printf("%d\n", *pos);
     int bound[100]; // to save upper and lower bound of one state in endstate
     int size = 0;
     int push = 1;
 
-    while(*pos < trDArrayGetSize(list) && (trDArrayGetData(trDArrayGetElement(list, *pos)) != ')' || trDArrayGetType(trDArrayGetElement(list, *pos)) != SYMBOL))
+    while(*pos < trDArrayGetSize(list) && ((trDArrayGetData(trDArrayGetElement(list, *pos)) != ')' && trDArrayGetData(trDArrayGetElement(list, *pos)) != ']') || trDArrayGetType(trDArrayGetElement(list, *pos)) != SYMBOL))
     {
-        if (trDArrayGetData(trDArrayGetElement(list, *pos)) == '(' && trDArrayGetType(trDArrayGetElement(list, *pos)) == SYMBOL)
+        if ((trDArrayGetData(trDArrayGetElement(list, *pos)) == '(' || trDArrayGetData(trDArrayGetElement(list, *pos)) == '[') && trDArrayGetType(trDArrayGetElement(list, *pos)) == SYMBOL)
         {
+            // '[' is group made by convertCode (not captured)
+            int capture = trDArrayGetData(trDArrayGetElement(list, *pos)) == '(';
             *pos += 1;
 
             int type = 0;
 
             TRDArray *startStateForThis = trDArrayInit(0, EMPTY);
             TRDArray *endStateForThis = trDArrayInit(0, EMPTY);
-            tRegexCompileFuncRec(startStateForThis, endStateForThis, list, pos);
+            int group = *groupCount;
+            *groupCount += capture;
+            tRegexCompileFuncRec(startStateForThis, endStateForThis, list, pos, groupCount);
+
+            // wrap sub graph with OPEN and CLOSE so engine could save where group start and end
+            if (capture == 1)
+            {
+                TRDArray *open = trDArrayInit(0, OPEN);
+                TRDArray *close = trDArrayInit(0, CLOSE);
+                open->group = group;
+                close->group = group;
+                trDArrayInsertAll(open, startStateForThis);
+                for (int j = 0; j < trDArrayGetSize(endStateForThis); j++)
+                {
+                    TRDArray *groupEnd = trDArrayGetElement(endStateForThis, j);
+                    if (trDArrayGetSize(groupEnd) == 0 || trDArrayGetElement(groupEnd, trDArrayGetSize(groupEnd) - 1) != close)
+                    {
+                        trDArrayPush(groupEnd, close);
+                    }
+                }
+                trDArrayMakeEmpty(startStateForThis);
+                trDArrayPush(startStateForThis, open);
+                trDArrayMakeEmpty(endStateForThis);
+                trDArrayPush(endStateForThis, close);
+            }
 
             if (*pos + 1 < trDArrayGetSize(list))
             {
@@ -556,8 +1192,8 @@ void tRegexCompileFuncRec(TRDArray *startState, TRDArray *endState, TRDArray *li
                     TRDArray *empty = trDArrayInit(0, EMPTY);
                     trDArrayPush(startState, empty);
                     trDArrayPush(endState, empty);
-                    bound[size - 1] = trDArrayGetSize(endState) - 1;
-                    bound[size] = bound[size - 1] + 1;
+                    // both the state and the empty skipping it are end of this part
+                    bound[size] = trDArrayGetSize(endState);
                     *pos += 1;
                 }
                 else if (type == 3)
@@ -565,8 +1201,7 @@ void tRegexCompileFuncRec(TRDArray *startState, TRDArray *endState, TRDArray *li
                     TRDArray *empty = trDArrayInit(0, EMPTY);
                     trDArrayPush(startState, empty);
                     trDArrayPush(endState, empty);
-                    bound[size - 1] = trDArrayGetSize(endState) - 1;
-                    bound[size] = bound[size - 1] + 1;
+                    bound[size] = trDArrayGetSize(endState);
                     *pos += 1;
                 }
             }
@@ -656,198 +1291,3775 @@ void tRegexCompileFuncRec(TRDArray *startState, TRDArray *endState, TRDArray *li
 }
 
 /**
-    Recursive function to check all graph by traversal depth first
-    @param startingState : location of current state
-    @param string : string to be checked
-    @param pos : position of string to be checked
-    @param length : length of string
-    @return 1 if there's minimum 1 pattern match, 0 if no patter match
+    Budget of one match, matching stop with TIMEOUT when one of it run out
+    @attribute steps : how many state could still be visited, negative if unlimited
+    @attribute deadline : monotonic clock in nanosecond when matching must stop, 0 if no deadline
+    @attribute spent : how many state already visited
+    @attribute depth : current recursion depth
+    @attribute tooDeep : 1 if matching stopped because depth reached tRegexBacktrackMaxDepth
+    @attribute entered : position where each empty state id is entered on current path, -1 if not on it
+                         (NULL to not check loop of empty state)
 */
-int tRegexCompareFuncRec(TRDArray *startingState, char *string, int pos, int length)
+typedef struct TRBudget
+{
+    long steps;
+    long long deadline;
+    long spent;
+    int depth;
+    int tooDeep;
+    int *entered;
+} TRBudget;
+
+/**
+    Function to read monotonic wall clock, not affected by other thread or by system time change
+    @return current time in nanosecond
+*/
+long long trBudgetNow()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/**
+    Function to initialize budget
+    @param steps : maximum state visited, negative if unlimited
+    @param seconds : maximum wall clock time in seconds, 0 or negative if unlimited
+    @return initialized budget
+*/
+TRBudget trBudgetInit(long steps, double seconds)
+{
+    TRBudget budget;
+    budget.steps = steps;
+    budget.deadline = seconds > 0 ? trBudgetNow() + (long long)(seconds * 1e9) : 0;
+    budget.spent = 0;
+    budget.depth = 0;
+    budget.tooDeep = 0;
+    budget.entered = NULL;
+    return budget;
+}
+
+/**
+    Function to spend one step of budget, clock only checked every 1024 step because it's slow
+    @param budget : budget to be spent
+    @return 1 if budget still available, 0 if run out
+*/
+int trBudgetSpend(TRBudget *budget)
+{
+    budget->spent += 1;
+    if (budget->steps >= 0 && budget->spent > budget->steps)
+    {
+        return 0;
+    }
+    if (budget->deadline != 0 && (budget->spent & 1023) == 0 && trBudgetNow() > budget->deadline)
+    {
+        return 0;
+    }
+    return 1;
+}
+
+#if defined(__AVX2__)
+/**
+    Function to compare 32 character at once with class of state
+    @param type : type of state (NORMAL, FOLDED, NUMBERS or LETTERS)
+    @param data : data of state
+    @param block : 32 character
+    @return bitmask, bit i is 1 if character i is consumed by state
+*/
+unsigned int trSkipMask32(int type, char data, __m256i block)
+{
+    __m256i inside;
+    if (type == NORMAL)
+    {
+        inside = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(data));
+    }
+    else if (type == FOLDED)
+    {
+        inside = _mm256_cmpeq_epi8(_mm256_or_si256(block, _mm256_set1_epi8(0x20)), _mm256_set1_epi8(data));
+    }
+    else if (type == NUMBERS)
+    {
+        inside = _mm256_and_si256(_mm256_cmpgt_epi8(block, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), block));
+    }
+    else
+    {
+        __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(block, _mm256_set1_epi8('A' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), block));
+        __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(block, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), block));
+        inside = _mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('_')));
+    }
+    return (unsigned int)_mm256_movemask_epi8(inside);
+}
+#elif defined(__SSE2__)
+/**
+    Function to compare 16 character at once with class of state
+    @param type : type of state (NORMAL, FOLDED, NUMBERS or LETTERS)
+    @param data : data of state
+    @param block : 16 character
+    @return bitmask, bit i is 1 if character i is consumed by state
+*/
+unsigned int trSkipMask16(int type, char data, __m128i block)
+{
+    __m128i inside;
+    if (type == NORMAL)
+    {
+        inside = _mm_cmpeq_epi8(block, _mm_set1_epi8(data));
+    }
+    else if (type == FOLDED)
+    {
+        inside = _mm_cmpeq_epi8(_mm_or_si128(block, _mm_set1_epi8(0x20)), _mm_set1_epi8(data));
+    }
+    else if (type == NUMBERS)
+    {
+        inside = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), block));
+    }
+    else
+    {
+        __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('A' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), block));
+        __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), block));
+        inside = _mm_or_si128(_mm_or_si128(upper, lower), _mm_cmpeq_epi8(block, _mm_set1_epi8('_')));
+    }
+    return (unsigned int)_mm_movemask_epi8(inside);
+}
+#endif
+
+int tRegexCompareFuncRec(TRDArray *startingState, const char *string, int pos, int length, TRBudget *budget);
+
+/**
+    Function to find where run of character consumed by state end, compare 32 (AVX2) or 16 (SSE2)
+    character at once if available
+    @param state : consuming state
+    @param string : string to be checked
+    @param pos : start of run
+    @param length : length of string
+    @return first position from pos that it's character is not consumed by state (length if none)
+*/
+int trSkipRun(TRDArray *state, const char *string, int pos, int length)
+{
+    int type = trDArrayGetType(state);
+    if (type == ANYTHING)
+    {
+        return length;
+    }
+
+    if (type == NORMAL || type == FOLDED || type == NUMBERS || type == LETTERS)
+    {
+#if defined(__AVX2__)
+        while (pos + 32 <= length)
+        {
+            unsigned int outside = ~trSkipMask32(type, trDArrayGetData(state), _mm256_loadu_si256((const __m256i*)(string + pos)));
+            if (outside != 0)
+            {
+                return pos + __builtin_ctz(outside);
+            }
+            pos += 32;
+        }
+#elif defined(__SSE2__)
+        while (pos + 16 <= length)
+        {
+            unsigned int outside = trSkipMask16(type, trDArrayGetData(state), _mm_loadu_si128((const __m128i*)(string + pos))) ^ 0xFFFF;
+            if (outside != 0)
+            {
+                return pos + __builtin_ctz(outside);
+            }
+            pos += 16;
+        }
+#endif
+    }
+
+    while (pos < length && trDArrayMatchByte(state, string[pos]) == 1)
+    {
+        pos += 1;
+    }
+    return pos;
+}
+
+/**
+    Function to check if state could start at position of string, empty state is always said could
+    @param state : state to be checked
+    @param string : string to be checked
+    @param pos : position of string
+    @param length : length of string
+    @return 1 if state could take character at pos (END only at end of string), 0 if not
+*/
+int trStateCanStart(TRDArray *state, const char *string, int pos, int length)
+{
+    if (trDArrayGetType(state) == END)
+    {
+        return pos == length;
+    }
+    if (trDArrayIsEpsilon(state) == 1)
+    {
+        return 1;
+    }
+    return pos < length && trDArrayMatchByte(state, string[pos]) == 1;
+}
+
+/**
+    Recursive function to check graph from state looping to itself (like \\w+ or .*), instead of one
+    recursion per character, the whole run consumed by the loop is skipped at once then every other
+    next state is tried from the end of the run back to the start (same order as backtracking),
+    only at position where it could start (trStateCanStart)
+    @param startingState : consuming state with itself as first next state
+    @param string : string to be checked
+    @param pos : position of string to be checked, must be consumed by startingState
+    @param length : length of string
+    @param budget : budget of this match (NULL if unlimited)
+    @return MATCH, NO_MATCH or TIMEOUT like tRegexCompareFuncRec
+*/
+int tRegexCompareRunFuncRec(TRDArray *startingState, const char *string, int pos, int length, TRBudget *budget)
+{
+    int end = trSkipRun(startingState, string, pos, length);
+    for (int k = end; k > pos; k--)
+    {
+        for (int i = 1; i < trDArrayGetSize(startingState); i++)
+        {
+            if (trDArrayGetElement(startingState, i) == startingState || trStateCanStart(trDArrayGetElement(startingState, i), string, k, length) == 0)
+            {
+                continue;
+            }
+            int result = tRegexCompareFuncRec(trDArrayGetElement(startingState, i), string, k, length, budget);
+            if (result != NO_MATCH)
+            {
+                return result;
+            }
+        }
+    }
+    return NO_MATCH;
+}
+
+/**
+    Recursive function to check one state and all graph after it by traversal depth first
+    @param startingState : location of current state
+    @param string : string to be checked
+    @param pos : position of string to be checked
+    @param length : length of string
+    @param budget : budget of this match (NULL if unlimited)
+    @return MATCH if there's minimum 1 pattern match, NO_MATCH if no patter match, TIMEOUT if budget run out
+*/
+int trCompareVisitFuncRec(TRDArray *startingState, const char *string, int pos, int length, TRBudget *budget)
 {
 //    printf("%c ", trDArrayGetData(startingState));
 //    printf("%d ", pos);
 
-    if (pos == length && trDArrayGetType(startingState) != START && trDArrayGetType(startingState) != EMPTY)
+    if (trProfilingEnabled() == 1)
+    {
+        __atomic_fetch_add(&startingState->hits, 1, __ATOMIC_RELAXED);
+    }
+
+    if (budget != NULL && trBudgetSpend(budget) == 0)
+    {
+        return TIMEOUT;
+    }
+
+    if (pos == length && trDArrayIsEpsilon(startingState) == 0)
+    {
+        if (trDArrayGetType(startingState) == END)
+        {
+            return 1;
+        }
+        return 0;
+    }
+    else if (trDArrayIsEpsilon(startingState) == 1)
+    {
+        int result = 0;
+        for (int i = 0; i < trDArrayGetSize(startingState); i++)
+        {
+            if (trProfilingEnabled() == 1)
+            {
+                trDArrayHitEdge(startingState, i);
+            }
+            result = tRegexCompareFuncRec(trDArrayGetElement(startingState, i), string, pos, length, budget);
+            if (result != NO_MATCH)
+            {
+                if (result == MATCH && trProfilingEnabled() == 1)
+                {
+                    trDArrayMatchEdge(startingState, i);
+                }
+                return result;
+            }
+        }
+        return 0;
+    }
+    else if (trProfilingEnabled() == 0 && trDArrayGetElement(startingState, 0) == startingState && trDArrayMatchByte(startingState, string[pos]) == 1)
+    {
+        return tRegexCompareRunFuncRec(startingState, string, pos, length, budget);
+    }
+    else if (trDArrayGetType(startingState) == NUMBERS)
+    {
+        if (string[pos] >= 48 && string[pos] <= 57)
+        {
+            int result = 0;
+            for (int i = 0; i < trDArrayGetSize(startingState); i++)
+            {
+                if (trProfilingEnabled() == 1)
+                {
+                    trDArrayHitEdge(startingState, i);
+                }
+                result = tRegexCompareFuncRec(trDArrayGetElement(startingState, i), string, pos+1, length, budget);
+                if (result != NO_MATCH)
+                {
+                    if (result == MATCH && trProfilingEnabled() == 1)
+                    {
+                        trDArrayMatchEdge(startingState, i);
+                    }
+                    return result;
+                }
+            }
+        }
+        else
+        {
+            return 0;
+        }
+    }
+    else if (trDArrayGetType(startingState) == LETTERS)
+    {
+        if ((string[pos] >= 65 && string[pos] <= 90) || (string[pos] >= 97 && string[pos] <= 122) || string[pos] == '_')
+        {
+            int result = 0;
+            for (int i = 0; i < trDArrayGetSize(startingState); i++)
+            {
+                if (trProfilingEnabled() == 1)
+                {
+                    trDArrayHitEdge(startingState, i);
+                }
+                result = tRegexCompareFuncRec(trDArrayGetElement(startingState, i), string, pos+1, length, budget);
+                if (result != NO_MATCH)
+                {
+                    if (result == MATCH && trProfilingEnabled() == 1)
+                    {
+                        trDArrayMatchEdge(startingState, i);
+                    }
+                    return result;
+                }
+            }
+        }
+        else
+        {
+            return 0;
+        }
+    }
+    else if (trDArrayMatchByte(startingState, string[pos]) == 1)
+    {
+        int result = 0;
+
+//        printf("pos: %c\n", string[pos]);
+        for (int i = 0; i < trDArrayGetSize(startingState); i++)
+        {
+            if (trProfilingEnabled() == 1)
+            {
+                trDArrayHitEdge(startingState, i);
+            }
+            result = tRegexCompareFuncRec(trDArrayGetElement(startingState, i), string, pos+1, length, budget);
+            if (result != NO_MATCH)
+            {
+                if (result == MATCH && trProfilingEnabled() == 1)
+                {
+                    trDArrayMatchEdge(startingState, i);
+                }
+                return result;
+            }
+        }
+        return 0;
+    }
+    return 0;
+}
+
+/**
+    Recursive function to check all graph by traversal depth first, empty state entered again at the same
+    position (loop like (a*)*) is not followed because it could only repeat the same path
+    @param startingState : location of current state
+    @param string : string to be checked
+    @param pos : position of string to be checked
+    @param length : length of string
+    @param budget : budget of this match (NULL if unlimited)
+    @return MATCH if there's minimum 1 pattern match, NO_MATCH if no patter match, TIMEOUT if budget run out
+            or recursion reached tRegexBacktrackMaxDepth (budget's tooDeep is set)
+*/
+int tRegexCompareFuncRec(TRDArray *startingState, const char *string, int pos, int length, TRBudget *budget)
+{
+    if (budget == NULL)
+    {
+        return trCompareVisitFuncRec(startingState, string, pos, length, budget);
+    }
+    if (budget->depth >= tRegexBacktrackMaxDepth)
+    {
+        budget->tooDeep = 1;
+        return TIMEOUT;
+    }
+
+    int tracked = budget->entered != NULL && trDArrayIsEpsilon(startingState) == 1;
+    int entered = tracked == 1 ? budget->entered[startingState->id] : -1;
+    if (tracked == 1 && entered == pos)
+    {
+        return NO_MATCH;
+    }
+    if (tracked == 1)
+    {
+        budget->entered[startingState->id] = pos;
+    }
+    budget->depth += 1;
+    int result = trCompareVisitFuncRec(startingState, string, pos, length, budget);
+    budget->depth -= 1;
+    if (tracked == 1)
+    {
+        budget->entered[startingState->id] = entered;
+    }
+    return result;
+}
+
+/**
+    Recursive function to add state to state set, empty state is replaced by all of it's next state
+    @param list : state set
+    @param state : state to be added
+    @param mark : last generation each state id added to a set
+    @param generation : generation of list
+*/
+void trStateSetAdd(TRDArray *list, TRDArray *state, int *mark, int generation)
+{
+    if (mark[state->id] == generation)
+    {
+        return;
+    }
+    mark[state->id] = generation;
+
+    if (trDArrayIsEpsilon(state) == 1)
+    {
+        for (int i = 0; i < trDArrayGetSize(state); i++)
+        {
+            trStateSetAdd(list, trDArrayGetElement(state, i), mark, generation);
+        }
+    }
+    else
+    {
+        trDArrayPush(list, state);
+    }
+}
+
+int trByteSetHas(const unsigned char *set, char c);
+void trByteSetAdd(unsigned char *set, char c);
+
+/**
+    Function to find where run of character that keep state set the same end, after reading character at pos
+    state set didn't change, so it also doesn't change after any next character taken by exactly the same
+    state of the set (like run of \\w for \\w*x or any character for .*). Long run is checked by bitset of
+    such character so each character cost one lookup whatever size of the set
+    @param list : state set before and after reading character at pos
+    @param string : string to be checked
+    @param pos : position of character that didn't change state set
+    @param length : length of string
+    @return last position from pos that it's character keep state set the same
+*/
+size_t trStateSetSkip(TRDArray *list, const char *string, size_t pos, size_t length)
+{
+    if (trDArrayGetSize(list) == 1 && length <= INT_MAX)
+    {
+        return trSkipRun(trDArrayGetElement(list, 0), string, (int)pos, (int)length) - 1;
+    }
+
+    size_t start = pos;
+    while (pos + 1 < length && pos - start < 256)
+    {
+        for (int i = 0; i < trDArrayGetSize(list); i++)
+        {
+            TRDArray *state = trDArrayGetElement(list, i);
+            if (trDArrayMatchByte(state, string[pos + 1]) != trDArrayMatchByte(state, string[pos]))
+            {
+                return pos;
+            }
+        }
+        pos += 1;
+    }
+
+    unsigned char keep[32];
+    memset(keep, 0, sizeof(keep));
+    for (int c = 0; c < 256; c++)
+    {
+        int same = 1;
+        for (int i = 0; i < trDArrayGetSize(list) && same == 1; i++)
+        {
+            TRDArray *state = trDArrayGetElement(list, i);
+            same = trDArrayMatchByte(state, (char)c) == trDArrayMatchByte(state, string[pos]);
+        }
+        if (same == 1)
+        {
+            trByteSetAdd(keep, (char)c);
+        }
+    }
+    while (pos + 1 < length && trByteSetHas(keep, string[pos + 1]) == 1)
+    {
+        pos += 1;
+    }
+    return pos;
+}
+
+/**
+    Slice of memory to be matched, array of slice is matched as if all of them joined (like iovec)
+    @attribute data : start of slice (doesn't need NUL terminator)
+    @attribute length : length of slice
+*/
+typedef struct TRSlice
+{
+    const char *data;
+    size_t length;
+} TRSlice;
+
+/**
+    Function to compare pattern of slices by simulating all possible state at once, slices are read
+    one after another without copying them, time is linear to total length times number of state.
+    Run of character that keep state set the same is skipped at once (trStateSetSkip).
+    When profiling, hits of every consuming state and it's taken edge is counted (not which edge lead to match)
+    and nothing is skipped
+    @param regex : compiled regex
+    @param slices : array of slice
+    @param sliceCount : number of slice
+    @return MATCH if pattern match, NO_MATCH if not, NO_MEMORY if allocator failed
+*/
+int trStateSetRun(const TRegex *regex, const TRSlice *slices, int sliceCount)
+{
+    int stateCount = trDArrayGetSize(regex->stateList);
+    int *mark = (int*)trMemoryCalloc(stateCount, sizeof(int));
+    TRDArray *currentList = trDArrayInit(0, EMPTY);
+    TRDArray *nextList = trDArrayInit(0, EMPTY);
+    int generation = 1;
+    int profiling = trProfilingEnabled();
+
+    // state is in a set at most once, so set never grow while matching
+    if (mark == NULL || currentList == NULL || nextList == NULL || trDArrayReserve(currentList, stateCount) == 0 || trDArrayReserve(nextList, stateCount) == 0)
+    {
+        trDArrayDelete(currentList);
+        trDArrayDelete(nextList);
+        trMemoryFree(mark);
+        return NO_MEMORY;
+    }
+
+    trStateSetAdd(currentList, regex->startingState, mark, generation);
+    for (int slice = 0; slice < sliceCount; slice++)
+    {
+        for (size_t pos = 0; pos < slices[slice].length && trDArrayGetSize(currentList) > 0; pos++)
+        {
+            generation += 1;
+            trDArrayMakeEmpty(nextList);
+            for (int i = 0; i < trDArrayGetSize(currentList); i++)
+            {
+                TRDArray *state = trDArrayGetElement(currentList, i);
+                if (profiling == 1)
+                {
+                    __atomic_fetch_add(&state->hits, 1, __ATOMIC_RELAXED);
+                }
+                if (trDArrayMatchByte(state, slices[slice].data[pos]) == 1)
+                {
+                    for (int j = 0; j < trDArrayGetSize(state); j++)
+                    {
+                        if (profiling == 1)
+                        {
+                            trDArrayHitEdge(state, j);
+                        }
+                        trStateSetAdd(nextList, trDArrayGetElement(state, j), mark, generation);
+                    }
+                }
+            }
+
+            // every state of set added again (mark is current generation) and nothing else, set is the same
+            int same = profiling == 0 && trDArrayGetSize(nextList) == trDArrayGetSize(currentList);
+            for (int i = 0; same == 1 && i < trDArrayGetSize(currentList); i++)
+            {
+                same = mark[trDArrayGetElement(currentList, i)->id] == generation;
+            }
+
+            TRDArray *temp = currentList;
+            currentList = nextList;
+            nextList = temp;
+            if (same == 1)
+            {
+                pos = trStateSetSkip(currentList, slices[slice].data, pos, slices[slice].length);
+            }
+        }
+    }
+
+    int result = NO_MATCH;
+    for (int i = 0; i < trDArrayGetSize(currentList); i++)
+    {
+        if (trDArrayGetType(trDArrayGetElement(currentList, i)) == END)
+        {
+            result = MATCH;
+        }
+    }
+
+    trDArrayDelete(currentList);
+    trDArrayDelete(nextList);
+    trMemoryFree(mark);
+    return result;
+}
+
+/**
+    Function to compare pattern by simulating all possible state at once,
+    time is linear to length of string times number of state and never backtrack
+    @param regex : compiled regex
+    @param string : string to be checked
+    @param length : length of string
+    @return MATCH if pattern match, NO_MATCH if not, NO_MEMORY if allocator failed
+*/
+int tRegexCompareStateSet(const TRegex *regex, const char *string, int length)
+{
+    if (regex->stateList == NULL)
+    {
+        return NO_MATCH;
+    }
+
+    TRSlice slice;
+    slice.data = string;
+    slice.length = length;
+    return trStateSetRun(regex, &slice, 1);
+}
+
+/**
+    Function to backtrack from starting state of regex, loop of empty state is cut
+    @param regex : regex to be checked
+    @param string : string to be checked
+    @param length : length of string
+    @param budget : budget of this match
+    @return result of tRegexCompareFuncRec, NO_MATCH if regex isn't compiled, NO_MEMORY if allocator failed
+*/
+int trBacktrack(const TRegex *regex, const char *string, int length, TRBudget *budget)
+{
+    if (regex->stateList == NULL)
+    {
+        return NO_MATCH;
+    }
+    budget->entered = (int*)trMemoryAlloc(sizeof(int) * trDArrayGetSize(regex->stateList));
+    if (budget->entered == NULL)
+    {
+        return NO_MEMORY;
+    }
+    memset(budget->entered, 0xFF, sizeof(int) * trDArrayGetSize(regex->stateList));
+    int result = tRegexCompareFuncRec(regex->startingState, string, 0, length, budget);
+    trMemoryFree(budget->entered);
+    budget->entered = NULL;
+    return result;
+}
+
+/**
+    Function to compare pattern of string with regex with limited budget by backtracking
+    @param regex : compiled regex
+    @param string : string to check is it match with regex
+    @param length : length of string
+    @param steps : maximum state visited, negative if unlimited
+    @param seconds : maximum wall clock time in seconds, 0 or negative if unlimited
+    @return MATCH if pattern match, NO_MATCH if not, TIMEOUT if budget run out before knowing,
+            TOO_LONG if length is bigger than INT_MAX, NO_MEMORY if allocator failed.
+            Match needing deeper recursion than tRegexBacktrackMaxDepth is finished by state set simulation
+*/
+int tRegexCompareBudget(const TRegex *regex, const char *string, size_t length, long steps, double seconds)
+{
+    if (length > INT_MAX)
+    {
+        return TOO_LONG;
+    }
+    TRBudget budget = trBudgetInit(steps, seconds);
+    int result = trBacktrack(regex, string, (int)length, &budget);
+    if (budget.tooDeep == 1)
+    {
+        result = tRegexCompareStateSet(regex, string, length);
+    }
+    return result;
+}
+
+/**
+    Function to compare pattern of string with regex, try backtracking first (fast for common pattern)
+    then change to state set simulation (linear time) if backtracking go over the budget
+    @param regex : compiled regex
+    @param string : string to check is it match with regex
+    @param length : length of string
+    @param steps : maximum state visited by backtracking, negative if unlimited
+    @return MATCH if pattern match, NO_MATCH if not, TOO_LONG if length is bigger than INT_MAX,
+            NO_MEMORY if allocator failed
+*/
+int tRegexCompareAuto(const TRegex *regex, const char *string, size_t length, long steps)
+{
+    if (length > INT_MAX)
+    {
+        return TOO_LONG;
+    }
+    TRBudget budget = trBudgetInit(steps, 0);
+    int result = trBacktrack(regex, string, (int)length, &budget);
+    if (result == TIMEOUT || result == NO_MEMORY)
+    {
+        result = tRegexCompareStateSet(regex, string, length);
+    }
+    return result;
+}
+
+void trEdgeFirstBytes(TRDArray *next, unsigned char *set, TRDArray *closure, int *mark, int generation);
+
+/**
+    First character of state (from trEdgeFirstBytes), only found when asked then kept for next time
+    @attribute sets : 34 byte for each state id, 33 byte from trEdgeFirstBytes then 1 if already found
+    @attribute closure : array used by trEdgeFirstBytes
+    @attribute mark : mark used by trEdgeFirstBytes
+    @attribute generation : last generation used with mark
+*/
+typedef struct TRFirstBytes
+{
+    unsigned char *sets;
+    TRDArray *closure;
+    int *mark;
+    int generation;
+} TRFirstBytes;
+
+/**
+    Function to delete memory of first character of state, field could be NULL
+    @param first : first character to be deleted
+*/
+void trFirstBytesDelete(TRFirstBytes *first)
+{
+    trMemoryFree(first->sets);
+    trDArrayDelete(first->closure);
+    trMemoryFree(first->mark);
+    first->sets = NULL;
+    first->closure = NULL;
+    first->mark = NULL;
+}
+
+/**
+    Function to allocate memory of first character for every state of regex, nothing is found yet
+    @param first : first character to be initialized
+    @param regex : compiled regex
+    @return 1 if success, 0 if allocation failed (nothing allocated)
+*/
+int trFirstBytesInit(TRFirstBytes *first, const TRegex *regex)
+{
+    int stateCount = trDArrayGetSize(regex->stateList);
+    first->sets = (unsigned char*)trMemoryCalloc(stateCount, 34);
+    first->closure = trDArrayInit(0, EMPTY);
+    first->mark = (int*)trMemoryCalloc(stateCount, sizeof(int));
+    first->generation = 0;
+
+    // closure must never be cut by failed push, or first character could be missed
+    if (first->sets == NULL || first->closure == NULL || first->mark == NULL || trDArrayReserve(first->closure, stateCount) == 0)
+    {
+        trFirstBytesDelete(first);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+    Function to check if match could continue from state at position of string by first character of state
+    @param first : first character of state
+    @param state : state to be checked
+    @param string : string to be checked
+    @param pos : position of string
+    @param length : length of string
+    @return 1 if state could take character at pos (or reach END at end of string), 0 if not
+*/
+int trFirstBytesCanStart(TRFirstBytes *first, TRDArray *state, const char *string, int pos, int length)
+{
+    unsigned char *set = first->sets + 34 * state->id;
+    if (set[33] == 0)
+    {
+        first->generation += 1;
+        trEdgeFirstBytes(state, set, first->closure, first->mark, first->generation);
+        set[33] = 1;
+    }
+    if (pos == length)
+    {
+        return set[32];
+    }
+    return trByteSetHas(set, string[pos]);
+}
+
+/**
+    Function to compare pattern by depth first traversal using explicit stack and bitmap of already
+    visited (state, position), every pair visited at most once so time is O(state * length)
+    and it never overflow C stack
+    @param regex : compiled regex
+    @param string : string to be checked
+    @param length : length of string
+    @return MATCH if pattern match, NO_MATCH if not, NO_MEMORY if allocator failed
+*/
+int tRegexCompareBitState(const TRegex *regex, const char *string, int length)
+{
+    if (regex->stateList == NULL)
+    {
+        return NO_MATCH;
+    }
+
+    long stride = length + 1;
+    long bits = trDArrayGetSize(regex->stateList) * stride;
+    unsigned char *visited = (unsigned char*)trMemoryCalloc((bits + 7) / 8, 1);
+    long capacity = 64;
+    long top = 0;
+    int *stack = (int*)trMemoryAlloc(sizeof(int) * 2 * capacity);
+    int result = NO_MATCH;
+    TRFirstBytes first = {NULL, NULL, NULL, 0};
+    if (visited == NULL || stack == NULL)
+    {
+        trMemoryFree(stack);
+        trMemoryFree(visited);
+        return NO_MEMORY;
+    }
+
+    visited[(regex->startingState->id * stride) / 8] |= 1 << ((regex->startingState->id * stride) % 8);
+    stack[0] = regex->startingState->id;
+    stack[1] = 0;
+    top = 1;
+
+    while (top > 0 && result == NO_MATCH)
+    {
+        top -= 1;
+        TRDArray *state = trDArrayGetElement(regex->stateList, stack[top * 2]);
+        int pos = stack[top * 2 + 1];
+        int nextPos = pos;
+
+        if (trDArrayGetType(state) == END)
+        {
+            if (pos == length)
+            {
+                result = MATCH;
+            }
+            continue;
+        }
+        else if (trDArrayIsEpsilon(state) == 0)
+        {
+            if (pos == length || trDArrayMatchByte(state, string[pos]) == 0)
+            {
+                continue;
+            }
+            nextPos = pos + 1;
+        }
+
+        // state looping to itself skip the whole run, other next state pushed only at position of the run
+        // where it's first character could be taken (first character found only when there's a run)
+        int selfLoop = nextPos > pos && trDArrayGetElement(state, 0) == state;
+        int lastPos = selfLoop == 1 ? trSkipRun(state, string, pos, length) : nextPos;
+        if (lastPos > nextPos && first.sets == NULL && trFirstBytesInit(&first, regex) == 0)
+        {
+            result = NO_MEMORY;
+            break;
+        }
+
+        // pushed from last so first next state (and end of run) is popped first
+        for (int k = nextPos; k <= lastPos && result == NO_MATCH; k++)
+        {
+            for (int i = trDArrayGetSize(state) - 1; i >= 0; i--)
+            {
+                long bit = trDArrayGetElement(state, i)->id * stride + k;
+                if ((visited[bit / 8] & (1 << (bit % 8))) != 0)
+                {
+                    continue;
+                }
+                visited[bit / 8] |= 1 << (bit % 8);
+                if (selfLoop == 1 && trDArrayGetElement(state, i) == state)
+                {
+                    continue;
+                }
+                if (lastPos > nextPos && trFirstBytesCanStart(&first, trDArrayGetElement(state, i), string, k, length) == 0)
+                {
+                    continue;
+                }
+
+                if (top >= capacity)
+                {
+                    int *newStack = (int*)trMemoryAlloc(sizeof(int) * 2 * capacity * 2);
+                    if (newStack == NULL)
+                    {
+                        result = NO_MEMORY;
+                        break;
+                    }
+                    memcpy(newStack, stack, sizeof(int) * 2 * capacity);
+                    trMemoryFree(stack);
+                    stack = newStack;
+                    capacity *= 2;
+                }
+                stack[top * 2] = trDArrayGetElement(state, i)->id;
+                stack[top * 2 + 1] = k;
+                top += 1;
+            }
+        }
+    }
+
+    trFirstBytesDelete(&first);
+    trMemoryFree(stack);
+    trMemoryFree(visited);
+    return result;
+}
+
+/**
+    Function to check if bit state engine is good choice for regex and length of string,
+    visited bitmap must be small and fit in memory budget together with the biggest stack it could need
+    (every pair pushed at most once) and first character of every state
+    @param regex : compiled regex
+    @param length : length of string
+    @return 1 if bit state engine should be used, 0 if not
+*/
+int tRegexBitStateFits(const TRegex *regex, int length)
+{
+    long stateCount = trDArrayGetSize(regex->stateList);
+    long bits = stateCount * (length + 1);
+    long first = stateCount * (34 + sizeof(int) + sizeof(TRDArray*));
+    return bits <= tRegexBitStateMaxBits && tRegexMemoryFits((bits + 7) / 8 + sizeof(int) * 2 * (bits + 64) + first);
+}
+
+/**
+    Recursive function to find longest path (in consumed character) from state to END by depth first
+    @param state : current state
+    @param longest : longest path from each state id, -1 if not yet known
+    @param canReachEnd : 1 if state id could reach END
+    @return longest path, -1 if cycle found (unbounded)
+*/
+int trLongestPath(TRDArray *state, int *longest, int *canReachEnd)
+{
+    if (state->visited == 1)
+    {
+        return -1;
+    }
+    if (longest[state->id] >= 0)
+    {
+        return longest[state->id];
+    }
+
+    state->visited = 1;
+    int result = 0;
+    for (int i = 0; i < trDArrayGetSize(state) && result >= 0; i++)
+    {
+        TRDArray *next = trDArrayGetElement(state, i);
+        if (canReachEnd[next->id] == 0)
+        {
+            continue;
+        }
+        int path = trLongestPath(next, longest, canReachEnd);
+        if (path < 0)
+        {
+            result = -1;
+        }
+        else if (path + (trDArrayIsEpsilon(state) == 1 ? 0 : 1) > result)
+        {
+            result = path + (trDArrayIsEpsilon(state) == 1 ? 0 : 1);
+        }
+    }
+    state->visited = 0;
+    longest[state->id] = result;
+    return result;
+}
+
+/**
+    Function to add character to bitset of character
+    @param set : bitset of 256 bit
+    @param c : character to be added
+*/
+void trByteSetAdd(unsigned char *set, char c)
+{
+    set[(unsigned char)c / 8] |= 1 << ((unsigned char)c % 8);
+}
+
+/**
+    Function to check if character is in bitset of character
+    @param set : bitset of 256 bit
+    @param c : character to be checked
+    @return 1 if c in set, 0 if not
+*/
+int trByteSetHas(const unsigned char *set, char c)
+{
+    return (set[(unsigned char)c / 8] >> ((unsigned char)c % 8)) & 1;
+}
+
+/**
+    Function to add every character consumed by state to bitset of character
+    @param set : bitset of 256 bit
+    @param state : consuming state
+*/
+void trByteSetAddState(unsigned char *set, TRDArray *state)
+{
+    for (int c = 0; c < 256; c++)
+    {
+        if (trDArrayMatchByte(state, (char)c) == 1)
+        {
+            trByteSetAdd(set, (char)c);
+        }
+    }
+}
+
+/**
+    Function to analyze compiled graph once so string could be rejected before traversal,
+    find minimum and maximum length, possible first and last character and if pattern is literal
+    @param regex : compiled regex
+*/
+void tRegexAnalyze(TRegex *regex)
+{
+    int stateCount = trDArrayGetSize(regex->stateList);
+    int *distance = (int*)trMemoryAlloc(sizeof(int) * stateCount);
+    int *canReachEnd = (int*)trMemoryCalloc(stateCount, sizeof(int));
+    int *mark = (int*)trMemoryCalloc(stateCount, sizeof(int));
+    TRDArray *closure = trDArrayInit(0, EMPTY);
+    int generation = 0;
+    int changed = 1;
+
+    // minimum length is shortest path counting only consuming state, relaxed until nothing change
+    for (int i = 0; i < stateCount; i++)
+    {
+        distance[i] = -1;
+    }
+    distance[regex->startingState->id] = 0;
+    while (changed == 1)
+    {
+        changed = 0;
+        for (int i = 0; i < stateCount; i++)
+        {
+            TRDArray *state = trDArrayGetElement(regex->stateList, i);
+            int length = distance[i] + (trDArrayIsEpsilon(state) == 1 ? 0 : 1);
+            for (int j = 0; j < trDArrayGetSize(state) && distance[i] >= 0; j++)
+            {
+                int next = trDArrayGetElement(state, j)->id;
+                if (distance[next] < 0 || length < distance[next])
+                {
+                    distance[next] = length;
+                    changed = 1;
+                }
+            }
+            if (trDArrayGetType(state) == END)
+            {
+                canReachEnd[i] = 1;
+            }
+        }
+    }
+
+    changed = 1;
+    while (changed == 1)
+    {
+        changed = 0;
+        for (int i = 0; i < stateCount; i++)
+        {
+            TRDArray *state = trDArrayGetElement(regex->stateList, i);
+            for (int j = 0; j < trDArrayGetSize(state) && canReachEnd[i] == 0; j++)
+            {
+                if (canReachEnd[trDArrayGetElement(state, j)->id] == 1)
+                {
+                    canReachEnd[i] = 1;
+                    changed = 1;
+                }
+            }
+        }
+    }
+
+    regex->minLength = -1;
+    for (int i = 0; i < stateCount; i++)
+    {
+        if (trDArrayGetType(trDArrayGetElement(regex->stateList, i)) == END)
+        {
+            regex->minLength = distance[i];
+        }
+    }
+
+    // maximum length is longest path, unbounded if there's cycle on the way to END
+    for (int i = 0; i < stateCount; i++)
+    {
+        distance[i] = -1;
+    }
+    regex->maxLength = canReachEnd[regex->startingState->id] == 1 ? trLongestPath(regex->startingState, distance, canReachEnd) : 0;
+
+    // first character come from consuming state reached from start, last character from consuming state reaching END
+    memset(regex->firstBytes, 0, sizeof(regex->firstBytes));
+    memset(regex->lastBytes, 0, sizeof(regex->lastBytes));
+    generation += 1;
+    trStateSetAdd(closure, regex->startingState, mark, generation);
+    for (int i = 0; i < trDArrayGetSize(closure); i++)
+    {
+        if (canReachEnd[trDArrayGetElement(closure, i)->id] == 1)
+        {
+            trByteSetAddState(regex->firstBytes, trDArrayGetElement(closure, i));
+        }
+    }
+    for (int i = 0; i < stateCount; i++)
+    {
+        TRDArray *state = trDArrayGetElement(regex->stateList, i);
+        if (trDArrayIsEpsilon(state) == 1 || trDArrayGetType(state) == END || canReachEnd[i] == 0)
+        {
+            continue;
+        }
+
+        generation += 1;
+        trDArrayMakeEmpty(closure);
+        for (int j = 0; j < trDArrayGetSize(state); j++)
+        {
+            trStateSetAdd(closure, trDArrayGetElement(state, j), mark, generation);
+        }
+        for (int j = 0; j < trDArrayGetSize(closure); j++)
+        {
+            if (trDArrayGetType(trDArrayGetElement(closure, j)) == END)
+            {
+                trByteSetAddState(regex->lastBytes, state);
+            }
+        }
+    }
+
+    // literal if graph is one chain of NORMAL state
+    TRDArray *state = regex->startingState;
+    int literalLength = 0;
+    regex->literal = 0;
+    while (trDArrayGetSize(state) == 1 && (trDArrayIsEpsilon(state) == 1 || trDArrayGetType(state) == NORMAL))
+    {
+        if (trDArrayGetType(state) == NORMAL)
+        {
+            regex->literalString[literalLength] = trDArrayGetData(state);
+            literalLength += 1;
+        }
+        state = trDArrayGetElement(state, 0);
+    }
+    regex->literalString[literalLength] = 0;
+    regex->literal = trDArrayGetType(state) == END;
+
+    trDArrayDelete(closure);
+    trMemoryFree(mark);
+    trMemoryFree(canReachEnd);
+    trMemoryFree(distance);
+}
+
+/**
+    Function to check string with result of tRegexAnalyze without traversing graph
+    @param regex : compiled and analyzed regex
+    @param string : string to be checked
+    @param length : length of string
+    @return NO_MATCH if string surely not match, MATCH if string surely match, -1 if graph need to be traversed
+*/
+int tRegexQuickCheck(const TRegex *regex, const char *string, int length)
+{
+    if (length < regex->minLength || regex->minLength < 0 || (regex->maxLength >= 0 && length > regex->maxLength))
+    {
+        return NO_MATCH;
+    }
+    if (length > 0 && (trByteSetHas(regex->firstBytes, string[0]) == 0 || trByteSetHas(regex->lastBytes, string[length - 1]) == 0))
+    {
+        return NO_MATCH;
+    }
+    if (regex->literal == 1)
+    {
+        return memcmp(regex->literalString, string, length) == 0 ? MATCH : NO_MATCH;
+    }
+    return -1;
+}
+
+/**
+    Function to compare pattern of buffer with regex, buffer doesn't need NUL terminator and could contain NUL
+    @param regex : compiled regex
+    @param buffer : start of memory to be checked
+    @param length : length of buffer
+    @return MATCH if pattern match, NO_MATCH if not, TOO_LONG if length is bigger than INT_MAX,
+            NO_MEMORY if allocator failed
+*/
+int tRegexMatch(const TRegex *regex, const char *buffer, size_t length)
+{
+    if (regex->stateList == NULL)
+    {
+        return NO_MATCH;
+    }
+    if (length > INT_MAX)
+    {
+        return TOO_LONG;
+    }
+
+    if (trProfilingEnabled() == 1 && (int)length < tRegexBacktrackMaxDepth)
+    {
+        // backtracking also count which edge lead to match
+        return tRegexCompareAuto(regex, buffer, length, (long)(length + 1) * trDArrayGetSize(regex->stateList));
+    }
+    else if (trProfilingEnabled() == 1)
+    {
+        // long string would recurse once per character, state set count hits without recursion
+        return tRegexCompareStateSet(regex, buffer, (int)length);
+    }
+
+    int result = tRegexQuickCheck(regex, buffer, (int)length);
+    if (result != -1)
+    {
+        return result;
+    }
+    else if (tRegexBitStateFits(regex, (int)length) == 1)
+    {
+        result = tRegexCompareBitState(regex, buffer, (int)length);
+        if (result != NO_MEMORY)
+        {
+            return result;
+        }
+        // state set need less memory (two set of state), try it before giving up
+    }
+    return tRegexCompareStateSet(regex, buffer, (int)length);
+}
+
+/**
+    Function to compare pattern of slices with regex as if all slices joined, without copying them
+    @param regex : compiled regex
+    @param slices : array of slice
+    @param sliceCount : number of slice
+    @return MATCH if pattern match, NO_MATCH if not, NO_MEMORY if allocator failed
+*/
+int tRegexMatchSlices(const TRegex *regex, const TRSlice *slices, int sliceCount)
+{
+    if (regex->stateList == NULL)
+    {
+        return NO_MATCH;
+    }
+
+    size_t length = 0;
+    int first = -1;
+    int last = -1;
+    for (int i = 0; i < sliceCount; i++)
+    {
+        length += slices[i].length;
+        if (slices[i].length > 0)
+        {
+            first = first < 0 ? i : first;
+            last = i;
+        }
+    }
+
+    if (length < (size_t)regex->minLength || regex->minLength < 0 || (regex->maxLength >= 0 && length > (size_t)regex->maxLength))
+    {
+        return NO_MATCH;
+    }
+    if (length > 0 && (trByteSetHas(regex->firstBytes, slices[first].data[0]) == 0 || trByteSetHas(regex->lastBytes, slices[last].data[slices[last].length - 1]) == 0))
+    {
+        return NO_MATCH;
+    }
+    if (regex->literal == 1)
+    {
+        size_t pos = 0;
+        for (int i = 0; i < sliceCount; i++)
+        {
+            if (memcmp(regex->literalString + pos, slices[i].data, slices[i].length) != 0)
+            {
+                return NO_MATCH;
+            }
+            pos += slices[i].length;
+        }
+        return MATCH;
+    }
+    else if (first == last && length <= INT_MAX)
+    {
+        return tRegexMatch(regex, first < 0 ? "" : slices[first].data, length);
+    }
+    // state set read slice with size_t position, so slice longer than INT_MAX is matched here too
+    return trStateSetRun(regex, slices, sliceCount);
+}
+
+/**
+    Function to compare pattern of string with regex
+    @param regex : regex that will used
+    @param string : string to check is it match with regex
+    @return 1 if there's minimum 1 pattern match, 0 if no patter match (or allocator failed)
+*/
+int tRegexComparePattern(TRegex regex, char *string)
+{
+    return tRegexMatch(&regex, string, strlen(string)) == MATCH;
+}
+
+/**
+    Function to turn profiling of matching on or off, when on every visited state and taken edge is counted
+    and every edge that lead to match is counted (training for tRegexOptimizeWithProfile)
+    @param enabled : 1 to turn on, 0 to turn off
+*/
+void tRegexSetProfiling(int enabled)
+{
+    __atomic_store_n(&tRegexProfiling, enabled, __ATOMIC_RELAXED);
+}
+
+/**
+    Function to reset all hit counter of compiled regex
+    @param regex : compiled regex
+*/
+void tRegexResetProfile(TRegex *regex)
+{
+    if (regex->stateList == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < trDArrayGetSize(regex->stateList); i++)
+    {
+        TRDArray *state = trDArrayGetElement(regex->stateList, i);
+        state->hits = 0;
+        trMemoryFree(state->edgeHits);
+        state->edgeHits = NULL;
+        trMemoryFree(state->edgeMatches);
+        state->edgeMatches = NULL;
+    }
+}
+
+/**
+    Function to find every character that could be taken first through an edge, epsilon state is followed
+    @param next : state the edge lead to
+    @param set : array of 33 byte, first 32 byte is bitset of character, last byte is 1 if END could be
+                 reached without taking character
+    @param closure : array to store state reached from next
+    @param mark : last generation each state id added to closure
+    @param generation : generation of this search
+*/
+void trEdgeFirstBytes(TRDArray *next, unsigned char *set, TRDArray *closure, int *mark, int generation)
+{
+    memset(set, 0, 33);
+    trDArrayMakeEmpty(closure);
+    trStateSetAdd(closure, next, mark, generation);
+    for (int i = 0; i < trDArrayGetSize(closure); i++)
+    {
+        if (trDArrayGetType(trDArrayGetElement(closure, i)) == END)
+        {
+            set[32] = 1;
+        }
+        else
+        {
+            trByteSetAddState(set, trDArrayGetElement(closure, i));
+        }
+    }
+}
+
+/**
+    Function to check if two edge could be tried in any order, it's true when they never take the same
+    character and neither could end the match, so for any string at most one of them could lead to match
+    @param first : first character of first edge from trEdgeFirstBytes
+    @param second : first character of second edge from trEdgeFirstBytes
+    @return 1 if order of the edge doesn't change any match or group, 0 if it could
+*/
+int trEdgeCommute(const unsigned char *first, const unsigned char *second)
+{
+    if (first[32] == 1 || second[32] == 1)
+    {
+        return 0;
+    }
+    for (int i = 0; i < 32; i++)
+    {
+        if ((first[i] & second[i]) != 0)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+    Function to reorder next-state-array so edge that lead to match most often is tried first, edge only
+    move before edge it commute with (trEdgeCommute) so leftmost first priority never change, edge with
+    same count keep their order
+    @param state : state that it's edge will be reordered
+    @param closure : array used by trEdgeFirstBytes
+    @param mark : mark used by trEdgeFirstBytes
+    @param generation : last generation used with mark, increased by this function
+    @return 1 if reordered, 0 if allocation failed (nothing changed)
+*/
+int trDArraySortByMatches(TRDArray *state, TRDArray *closure, int *mark, int *generation)
+{
+    if (state->edgeMatches == NULL || trDArrayGetSize(state) < 2)
+    {
+        return 1;
+    }
+    unsigned char *sets = (unsigned char*)trMemoryAlloc(33 * trDArrayGetSize(state));
+    unsigned char set[33];
+    if (sets == NULL)
+    {
+        return 0;
+    }
+    for (int i = 0; i < trDArrayGetSize(state); i++)
+    {
+        *generation += 1;
+        trEdgeFirstBytes(trDArrayGetElement(state, i), sets + 33 * i, closure, mark, *generation);
+    }
+
+    for (int i = 1; i < trDArrayGetSize(state); i++)
+    {
+        TRDArray *next = trDArrayGetElement(state, i);
+        long matches = state->edgeMatches[i];
+        long hits = state->edgeHits == NULL ? 0 : state->edgeHits[i];
+        memcpy(set, sets + 33 * i, 33);
+        int j = i - 1;
+        while (j >= 0 && state->edgeMatches[j] < matches && trEdgeCommute(sets + 33 * j, set) == 1)
+        {
+            state->nextState[j + 1] = state->nextState[j];
+            state->edgeMatches[j + 1] = state->edgeMatches[j];
+            if (state->edgeHits != NULL)
+            {
+                state->edgeHits[j + 1] = state->edgeHits[j];
+            }
+            memcpy(sets + 33 * (j + 1), sets + 33 * j, 33);
+            j -= 1;
+        }
+        state->nextState[j + 1] = next;
+        state->edgeMatches[j + 1] = matches;
+        if (state->edgeHits != NULL)
+        {
+            state->edgeHits[j + 1] = hits;
+        }
+        memcpy(sets + 33 * (j + 1), set, 33);
+    }
+    trMemoryFree(sets);
+    return 1;
+}
+
+/**
+    Function to move every state except starting state to new memory in order of stateList, so state
+    visited most often is allocated next to each other. Starting state and stateList keep their address
+    so copy of the regex still point to valid state
+    @param regex : compiled regex, id of every state is it's index in stateList
+    @return 1 if moved, 0 if allocation failed (nothing changed)
+*/
+int trLayoutStates(TRegex *regex)
+{
+    int stateCount = trDArrayGetSize(regex->stateList);
+    TRDArray **moved = (TRDArray**)trMemoryCalloc(stateCount, sizeof(TRDArray*));
+    int allocated = 0;
+    if (moved == NULL)
+    {
+        return 0;
+    }
+    for (; allocated < stateCount; allocated++)
+    {
+        TRDArray *state = trDArrayGetElement(regex->stateList, allocated);
+        if (state == regex->startingState)
+        {
+            moved[allocated] = state;
+            continue;
+        }
+        moved[allocated] = (TRDArray*)trMemoryAlloc(sizeof(TRDArray));
+        TRDArray **nextState = moved[allocated] == NULL ? NULL : (TRDArray**)trMemoryAlloc(sizeof(TRDArray*) * trDArrayGetCapacity(state));
+        if (nextState == NULL)
+        {
+            trMemoryFree(moved[allocated]);
+            break;
+        }
+        *moved[allocated] = *state;
+        moved[allocated]->nextState = nextState;
+    }
+    if (allocated < stateCount)
+    {
+        for (int i = 0; i < allocated; i++)
+        {
+            if (moved[i] != regex->startingState)
+            {
+                trMemoryFree(moved[i]->nextState);
+                trMemoryFree(moved[i]);
+            }
+        }
+        trMemoryFree(moved);
+        return 0;
+    }
+
+    // old state is still there, so next state is found by it's id
+    for (int i = 0; i < stateCount; i++)
+    {
+        TRDArray *state = trDArrayGetElement(regex->stateList, i);
+        for (int j = 0; j < trDArrayGetSize(state); j++)
+        {
+            moved[i]->nextState[j] = moved[trDArrayGetElement(state, j)->id];
+        }
+    }
+    for (int i = 0; i < stateCount; i++)
+    {
+        TRDArray *state = trDArrayGetElement(regex->stateList, i);
+        if (state != regex->startingState)
+        {
+            // edge counter now belong to the moved state
+            trMemoryFree(state->nextState);
+            trMemoryFree(state);
+            trDArraySetElement(regex->stateList, moved[i], i);
+        }
+    }
+    trMemoryFree(moved);
+    return 1;
+}
+
+/**
+    Function to optimize compiled regex with profile recorded while tRegexSetProfiling is on,
+    every next-state-array is reordered so edge that lead to match most often is tried first (only when
+    it doesn't change which match or group is found), then state list is reordered from the most visited
+    so hot state have small id and every state except starting state is allocated again in that order
+    so hot state is next to each other in memory. Copy of the regex still point to valid state
+    @param regex : compiled regex that already matched representative string with profiling on
+*/
+void tRegexOptimizeWithProfile(TRegex *regex)
+{
+    if (regex->stateList == NULL || regex->shared == 1)
+    {
+        return;
+    }
+
+    int stateCount = trDArrayGetSize(regex->stateList);
+    int *mark = (int*)trMemoryCalloc(stateCount, sizeof(int));
+    TRDArray *closure = trDArrayInit(0, EMPTY);
+    int generation = 0;
+    // closure must never be cut by failed push, or first byte of an edge could be missed
+    int reserved = closure != NULL && trDArrayReserve(closure, stateCount) == 1;
+    for (int i = 0; i < stateCount && mark != NULL && reserved == 1; i++)
+    {
+        if (trDArraySortByMatches(trDArrayGetElement(regex->stateList, i), closure, mark, &generation) == 0)
+        {
+            break;
+        }
+    }
+    trDArrayDelete(closure);
+    trMemoryFree(mark);
+
+    for (int i = 0; i < stateCount; i++)
+    {
+        TRDArray *state = trDArrayGetElement(regex->stateList, i);
+        int j = i - 1;
+        while (j >= 0 && trDArrayGetElement(regex->stateList, j)->hits < state->hits)
+        {
+            trDArraySetElement(regex->stateList, trDArrayGetElement(regex->stateList, j), j + 1);
+            j -= 1;
+        }
+        trDArraySetElement(regex->stateList, state, j + 1);
+    }
+    for (int i = 0; i < stateCount; i++)
+    {
+        trDArrayGetElement(regex->stateList, i)->id = i;
+    }
+    trLayoutStates(regex);
+}
+
+/**
+    Function to get name of state type for printing
+    @param type : type of state
+    @return name of type
+*/
+const char *trDArrayTypeName(int type)
+{
+    switch (type)
+    {
+        case NORMAL: return "NORMAL";
+        case START: return "START";
+        case END: return "END";
+        case EMPTY: return "EMPTY";
+        case NUMBERS: return "NUMBERS";
+        case LETTERS: return "LETTERS";
+        case ANYTHING: return "ANYTHING";
+        case RANGE: return "RANGE";
+        case FOLDED: return "FOLDED";
+        case SYMBOL: return "SYMBOL";
+        case OPEN: return "OPEN";
+        case CLOSE: return "CLOSE";
+    }
+    return "UNKNOWN";
+}
+
+/**
+    Function to write compiled graph in Graphviz DOT format, node labeled with it's type and hits,
+    edge labeled and weighted with how many times it's taken
+    @param regex : compiled regex
+    @param file : file to write DOT
+*/
+void tRegexDumpDot(const TRegex *regex, FILE *file)
+{
+    if (regex->stateList == NULL)
+    {
+        return;
+    }
+
+    long maxHits = 1;
+    for (int i = 0; i < trDArrayGetSize(regex->stateList); i++)
+    {
+        TRDArray *state = trDArrayGetElement(regex->stateList, i);
+        for (int j = 0; state->edgeHits != NULL && j < trDArrayGetSize(state); j++)
+        {
+            if (state->edgeHits[j] > maxHits)
+            {
+                maxHits = state->edgeHits[j];
+            }
+        }
+    }
+
+    fprintf(file, "digraph tregex {\n");
+    for (int i = 0; i < trDArrayGetSize(regex->stateList); i++)
+    {
+        TRDArray *state = trDArrayGetElement(regex->stateList, i);
+        fprintf(file, "    n%d [label=\"%s", state->id, trDArrayTypeName(trDArrayGetType(state)));
+        if (trDArrayGetType(state) == OPEN || trDArrayGetType(state) == CLOSE)
+        {
+            fprintf(file, " %d", trDArrayGetGroup(state));
+        }
+        else if (trDArrayGetType(state) == RANGE)
+        {
+            fprintf(file, " 0x%02x-0x%02x", (unsigned char)trDArrayGetData(state), (unsigned char)state->dataEnd);
+        }
+        else if (trDArrayGetType(state) == NORMAL || trDArrayGetType(state) == FOLDED)
+        {
+            char data = trDArrayGetData(state);
+            if (data == '"' || data == '\\')
+            {
+                fprintf(file, " '\\%c'", data);
+            }
+            else if (data >= 32 && data <= 126)
+            {
+                fprintf(file, " '%c'", data);
+            }
+            else
+            {
+                fprintf(file, " 0x%02x", (unsigned char)data);
+            }
+        }
+        fprintf(file, "\\nhits=%ld\"];\n", state->hits);
+    }
+    for (int i = 0; i < trDArrayGetSize(regex->stateList); i++)
+    {
+        TRDArray *state = trDArrayGetElement(regex->stateList, i);
+        for (int j = 0; j < trDArrayGetSize(state); j++)
+        {
+            long edgeHits = state->edgeHits == NULL ? 0 : state->edgeHits[j];
+            fprintf(file, "    n%d -> n%d [label=\"%ld\", penwidth=%.2f];\n", state->id,
+                    trDArrayGetElement(state, j)->id, edgeHits, 1.0 + 4.0 * edgeHits / maxHits);
+        }
+    }
+    fprintf(file, "}\n");
+}
+
+
+/**
+    Recursive function to collect state reachable from state without consuming character,
+    fail if any state could be reached by more than one path
+    @param state : current state
+    @param reached : array to store reached consuming state and END
+    @param mark : last generation each state id reached
+    @param generation : generation of this search
+    @return 1 if every state reached by exactly one path, 0 if not
+*/
+int trOnePassClosure(TRDArray *state, TRDArray *reached, int *mark, int generation)
+{
+    if (mark[state->id] == generation)
+    {
+        return 0;
+    }
+    mark[state->id] = generation;
+
+    if (trDArrayIsEpsilon(state) == 0)
+    {
+        trDArrayPush(reached, state);
+        return 1;
+    }
+    for (int i = 0; i < trDArrayGetSize(state); i++)
+    {
+        if (trOnePassClosure(trDArrayGetElement(state, i), reached, mark, generation) == 0)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+    Function to check if regex is one pass, it means from start and from every consuming state,
+    every next consuming state reached by one path only and no two of them consume same character,
+    so group could be matched by following one state without keeping other possibility
+    @param regex : compiled regex
+    @return 1 if regex is one pass, 0 if not
+*/
+int tRegexIsOnePass(const TRegex *regex)
+{
+    int stateCount = trDArrayGetSize(regex->stateList);
+    int *mark = (int*)trMemoryCalloc(stateCount, sizeof(int));
+    TRDArray *reached = trDArrayInit(0, EMPTY);
+    int generation = 0;
+    int onePass = 1;
+    if (mark == NULL || reached == NULL || trDArrayReserve(reached, stateCount) == 0)
+    {
+        // pike VM give the same group without this check
+        trDArrayDelete(reached);
+        trMemoryFree(mark);
+        return 0;
+    }
+
+    for (int i = 0; i < trDArrayGetSize(regex->stateList) && onePass == 1; i++)
+    {
+        TRDArray *source = trDArrayGetElement(regex->stateList, i);
+        if (source != regex->startingState && (trDArrayIsEpsilon(source) == 1 || trDArrayGetType(source) == END))
+        {
+            continue;
+        }
+
+        trDArrayMakeEmpty(reached);
+        generation += 1;
+        if (source == regex->startingState)
+        {
+            onePass = trOnePassClosure(source, reached, mark, generation);
+        }
+        for (int j = 0; j < trDArrayGetSize(source) && source != regex->startingState && onePass == 1; j++)
+        {
+            onePass = trOnePassClosure(trDArrayGetElement(source, j), reached, mark, generation);
+        }
+
+        for (int c = 0; c < 256 && onePass == 1; c++)
+        {
+            int consumer = 0;
+            for (int j = 0; j < trDArrayGetSize(reached); j++)
+            {
+                consumer += trDArrayMatchByte(trDArrayGetElement(reached, j), (char)c);
+            }
+            onePass = consumer <= 1;
+        }
+    }
+
+    trDArrayDelete(reached);
+    trMemoryFree(mark);
+    return onePass;
+}
+
+/**
+    Recursive function to follow the only path from state to state that consume character (or END),
+    saving group position passed by the path
+    @param state : current state
+    @param c : character to be consumed
+    @param atEnd : 1 if looking for END (no character left), 0 if not
+    @param pos : current position of string
+    @param groups : position of every group start and end
+    @return state that consume c (or END), NULL if no state found
+*/
+TRDArray *trOnePassFind(TRDArray *state, char c, int atEnd, int pos, int *groups)
+{
+    if (trDArrayIsEpsilon(state) == 0)
+    {
+        if (trDArrayGetType(state) == END)
+        {
+            return atEnd == 1 ? state : NULL;
+        }
+        return atEnd == 0 && trDArrayMatchByte(state, c) == 1 ? state : NULL;
+    }
+
+    for (int i = 0; i < trDArrayGetSize(state); i++)
+    {
+        TRDArray *found = trOnePassFind(trDArrayGetElement(state, i), c, atEnd, pos, groups);
+        if (found != NULL)
+        {
+            if (trDArrayGetType(state) == OPEN)
+            {
+                groups[trDArrayGetGroup(state) * 2] = pos;
+            }
+            else if (trDArrayGetType(state) == CLOSE)
+            {
+                groups[trDArrayGetGroup(state) * 2 + 1] = pos;
+            }
+            return found;
+        }
+    }
+    return NULL;
+}
+
+/**
+    Function to match one pass regex with group, only one state active at a time
+    @param regex : compiled one pass regex
+    @param string : string to be checked
+    @param length : length of string
+    @param groups : array of 2 * groupCount int to store start and end of every group
+    @return MATCH if pattern match, NO_MATCH if not
+*/
+int tRegexMatchOnePass(const TRegex *regex, const char *string, int length, int *groups)
+{
+    TRDArray *state = regex->startingState;
+    for (int pos = 0; pos <= length && state != NULL; pos++)
+    {
+        // start is looked from itself, consuming state is looked from it's next state
+        TRDArray *found = NULL;
+        if (state == regex->startingState)
+        {
+            found = trOnePassFind(state, pos < length ? string[pos] : 0, pos == length, pos, groups);
+        }
+        for (int i = 0; i < trDArrayGetSize(state) && found == NULL && state != regex->startingState; i++)
+        {
+            found = trOnePassFind(trDArrayGetElement(state, i), pos < length ? string[pos] : 0, pos == length, pos, groups);
+        }
+        if (found != NULL && trDArrayGetType(found) == END)
+        {
+            return MATCH;
+        }
+        state = found;
+    }
+    return NO_MATCH;
+}
+
+/**
+    Recursive function to add thread to thread list of pike VM, empty state is replaced by all of
+    it's next state and group position is saved when passing OPEN or CLOSE
+    @param list : thread list (state of each thread)
+    @param listGroups : group position of each thread, row i for thread i
+    @param state : state to be added
+    @param pos : current position of string
+    @param groups : group position of the thread being added
+    @param slotCount : number of group position (2 * groupCount)
+    @param mark : last generation each state id added to a list
+    @param generation : generation of list
+*/
+void trPikeAdd(TRDArray *list, int *listGroups, TRDArray *state, int pos, int *groups, int slotCount, int *mark, int generation)
+{
+    if (mark[state->id] == generation)
+    {
+        return;
+    }
+    mark[state->id] = generation;
+
+    if (trDArrayIsEpsilon(state) == 1)
+    {
+        int slot = -1;
+        int old = 0;
+        if (trDArrayGetType(state) == OPEN || trDArrayGetType(state) == CLOSE)
+        {
+            slot = trDArrayGetGroup(state) * 2 + (trDArrayGetType(state) == CLOSE ? 1 : 0);
+            old = groups[slot];
+            groups[slot] = pos;
+        }
+        for (int i = 0; i < trDArrayGetSize(state); i++)
+        {
+            trPikeAdd(list, listGroups, trDArrayGetElement(state, i), pos, groups, slotCount, mark, generation);
+        }
+        if (slot >= 0)
+        {
+            groups[slot] = old;
+        }
+    }
+    else
+    {
+        memcpy(listGroups + trDArrayGetSize(list) * slotCount, groups, sizeof(int) * slotCount);
+        trDArrayPush(list, state);
+    }
+}
+
+/**
+    Which state could still reach END from every position of one string, so search could drop thread that
+    never match. Only row of every window-th position (checkpoint) and row of one window is kept, so memory
+    is about square root of length times number of state in bit
+    @attribute length : length of string
+    @attribute stride : bytes of one row (one bit for each state id)
+    @attribute window : number of position between checkpoint
+    @attribute windowStart : first position of rows, -1 if rows is not computed
+    @attribute checkpoints : row of every position divisible by window
+    @attribute rows : row of position windowStart until windowStart + window
+    @attribute predecessorStart : index in predecessor of first empty state going to each state id
+    @attribute predecessor : id of empty state going to each state, grouped by state
+    @attribute stack : state id waiting to mark it's predecessor
+*/
+typedef struct TRLiveMap
+{
+    int length;
+    int stride;
+    int window;
+    int windowStart;
+    unsigned char *checkpoints;
+    unsigned char *rows;
+    int *predecessorStart;
+    int *predecessor;
+    int *stack;
+} TRLiveMap;
+
+/**
+    Function to free live map
+    @param map : live map to be freed (could be NULL, part not allocated is NULL)
+*/
+void trLiveDelete(TRLiveMap *map)
+{
+    if (map == NULL)
+    {
+        return;
+    }
+    trMemoryFree(map->stack);
+    trMemoryFree(map->predecessor);
+    trMemoryFree(map->predecessorStart);
+    trMemoryFree(map->rows);
+    trMemoryFree(map->checkpoints);
+    trMemoryFree(map);
+}
+
+/**
+    Function to compute row of one position from row of the next position, state is alive if it's END,
+    consume character at pos and one of it's next state alive at pos + 1, or it's empty state with
+    one of it's next state alive at pos
+    @param regex : compiled regex
+    @param map : live map
+    @param string : string to be checked
+    @param pos : position of row
+    @param next : row of pos + 1, NULL if pos is length
+    @param row : row to be computed
+*/
+void trLiveStep(const TRegex *regex, TRLiveMap *map, const char *string, int pos, const unsigned char *next, unsigned char *row)
+{
+    int top = 0;
+    memset(row, 0, map->stride);
+    for (int i = 0; i < trDArrayGetSize(regex->stateList); i++)
+    {
+        TRDArray *state = trDArrayGetElement(regex->stateList, i);
+        int alive = trDArrayGetType(state) == END;
+        if (next != NULL && trDArrayIsEpsilon(state) == 0 && trDArrayMatchByte(state, string[pos]) == 1)
+        {
+            for (int j = 0; j < trDArrayGetSize(state) && alive == 0; j++)
+            {
+                int id = trDArrayGetElement(state, j)->id;
+                alive = (next[id / 8] >> (id % 8)) & 1;
+            }
+        }
+        if (alive == 1)
+        {
+            row[i / 8] |= 1 << (i % 8);
+            map->stack[top] = i;
+            top += 1;
+        }
+    }
+
+    // empty state going to alive state is alive too, every state is pushed once
+    while (top > 0)
+    {
+        top -= 1;
+        int id = map->stack[top];
+        for (int k = map->predecessorStart[id]; k < map->predecessorStart[id + 1]; k++)
+        {
+            int previous = map->predecessor[k];
+            if (((row[previous / 8] >> (previous % 8)) & 1) == 0)
+            {
+                row[previous / 8] |= 1 << (previous % 8);
+                map->stack[top] = previous;
+                top += 1;
+            }
+        }
+    }
+}
+
+/**
+    Function to compute live map of string by going backward once and keeping checkpoint rows
+    @param regex : compiled regex
+    @param string : string to be checked
+    @param length : length of string
+    @return live map, NULL if allocator failed
+*/
+TRLiveMap *trLiveInit(const TRegex *regex, const char *string, int length)
+{
+    int stateCount = trDArrayGetSize(regex->stateList);
+    TRLiveMap *map = (TRLiveMap*)trMemoryCalloc(1, sizeof(TRLiveMap));
+    if (map == NULL)
+    {
+        return NULL;
+    }
+    map->length = length;
+    map->stride = (stateCount + 7) / 8;
+    map->window = 64;
+    while ((long)map->window * map->window < length)
+    {
+        map->window *= 2;
+    }
+    map->windowStart = -1;
+
+    int edgeCount = 0;
+    for (int i = 0; i < stateCount; i++)
+    {
+        edgeCount += trDArrayGetSize(trDArrayGetElement(regex->stateList, i));
+    }
+    map->checkpoints = (unsigned char*)trMemoryAlloc((size_t)map->stride * (length / map->window + 1));
+    map->rows = (unsigned char*)trMemoryAlloc((size_t)map->stride * (map->window + 1));
+    map->predecessorStart = (int*)trMemoryCalloc(stateCount + 2, sizeof(int));
+    map->predecessor = (int*)trMemoryAlloc(sizeof(int) * edgeCount + 1);
+    map->stack = (int*)trMemoryAlloc(sizeof(int) * stateCount + 1);
+    if (map->checkpoints == NULL || map->rows == NULL || map->predecessorStart == NULL || map->predecessor == NULL || map->stack == NULL)
+    {
+        trLiveDelete(map);
+        return NULL;
+    }
+
+    for (int i = 0; i < stateCount; i++)
+    {
+        TRDArray *state = trDArrayGetElement(regex->stateList, i);
+        for (int j = 0; j < trDArrayGetSize(state) && trDArrayIsEpsilon(state) == 1; j++)
+        {
+            map->predecessorStart[trDArrayGetElement(state, j)->id + 2] += 1;
+        }
+    }
+    for (int i = 0; i < stateCount; i++)
+    {
+        map->predecessorStart[i + 2] += map->predecessorStart[i + 1];
+    }
+    for (int i = 0; i < stateCount; i++)
+    {
+        TRDArray *state = trDArrayGetElement(regex->stateList, i);
+        for (int j = 0; j < trDArrayGetSize(state) && trDArrayIsEpsilon(state) == 1; j++)
+        {
+            map->predecessor[map->predecessorStart[trDArrayGetElement(state, j)->id + 1]++] = i;
+        }
+    }
+
+    // first two rows is used as working row, only checkpoint is kept
+    unsigned char *next = NULL;
+    for (int pos = length; pos >= 0; pos--)
+    {
+        unsigned char *row = map->rows + (size_t)map->stride * (pos % 2);
+        trLiveStep(regex, map, string, pos, next, row);
+        if (pos % map->window == 0)
+        {
+            memcpy(map->checkpoints + (size_t)map->stride * (pos / map->window), row, map->stride);
+        }
+        next = row;
+    }
+    return map;
+}
+
+/**
+    Function to check if state could still reach END from position, row of window containing position
+    is computed again from the next checkpoint when needed
+    @param regex : compiled regex
+    @param map : live map of string
+    @param string : string to be checked
+    @param state : state to be checked
+    @param pos : position of state
+    @return 1 if state could reach END, 0 if not
+*/
+int trLiveHas(const TRegex *regex, TRLiveMap *map, const char *string, TRDArray *state, int pos)
+{
+    int windowStart = pos - pos % map->window;
+    if (windowStart != map->windowStart)
+    {
+        int last = windowStart + map->window < map->length ? windowStart + map->window : map->length;
+        unsigned char *row = map->rows + (size_t)map->stride * (last - windowStart);
+        if (last % map->window == 0)
+        {
+            memcpy(row, map->checkpoints + (size_t)map->stride * (last / map->window), map->stride);
+        }
+        else
+        {
+            trLiveStep(regex, map, string, last, NULL, row);
+        }
+        for (int i = last - 1; i >= windowStart; i--)
+        {
+            trLiveStep(regex, map, string, i, row, row - map->stride);
+            row -= map->stride;
+        }
+        map->windowStart = windowStart;
+    }
+    unsigned char *row = map->rows + (size_t)map->stride * (pos - windowStart);
+    return (row[state->id / 8] >> (state->id % 8)) & 1;
+}
+
+/**
+    Working memory of pike VM, allocated once so it could be used for many match
+    @attribute mark : last generation each state id added to a list
+    @attribute currentGroups : group position of each thread in currentList
+    @attribute nextGroups : group position of each thread in nextList
+    @attribute threadGroups : group position of thread being added
+    @attribute currentList : thread at current position
+    @attribute nextList : thread at next position
+    @attribute generation : generation of currentList
+    @attribute live : live map of string being searched (only for search not anchored), NULL if every thread is kept
+    @attribute stopped : position where last trPikeRun stopped reading string
+*/
+typedef struct TRPike
+{
+    int *mark;
+    int *currentGroups;
+    int *nextGroups;
+    int *threadGroups;
+    TRDArray *currentList;
+    TRDArray *nextList;
+    int generation;
+    TRLiveMap *live;
+    int stopped;
+} TRPike;
+
+/**
+    Function to free working memory of pike VM
+    @param pike : working memory to be freed (part not allocated is NULL)
+*/
+void trPikeDelete(TRPike *pike)
+{
+    trLiveDelete(pike->live);
+    trDArrayDelete(pike->currentList);
+    trDArrayDelete(pike->nextList);
+    trMemoryFree(pike->threadGroups);
+    trMemoryFree(pike->nextGroups);
+    trMemoryFree(pike->currentGroups);
+    trMemoryFree(pike->mark);
+}
+
+/**
+    Function to allocate working memory of pike VM for regex, thread list could hold every state
+    so it never grow while matching
+    @param pike : working memory to be initialized
+    @param regex : compiled regex
+    @return 1 if initialized, 0 if allocator failed (nothing left to be freed)
+*/
+int trPikeInit(TRPike *pike, const TRegex *regex)
+{
+    int stateCount = trDArrayGetSize(regex->stateList);
+    int slotCount = regex->groupCount * 2;
+    pike->mark = (int*)trMemoryCalloc(stateCount, sizeof(int));
+    pike->currentGroups = (int*)trMemoryAlloc(sizeof(int) * stateCount * slotCount + 1);
+    pike->nextGroups = (int*)trMemoryAlloc(sizeof(int) * stateCount * slotCount + 1);
+    pike->threadGroups = (int*)trMemoryAlloc(sizeof(int) * slotCount + 1);
+    pike->currentList = trDArrayInit(0, EMPTY);
+    pike->nextList = trDArrayInit(0, EMPTY);
+    pike->generation = 0;
+    pike->live = NULL;
+    pike->stopped = 0;
+    if (pike->mark == NULL || pike->currentGroups == NULL || pike->nextGroups == NULL || pike->threadGroups == NULL
+        || pike->currentList == NULL || pike->nextList == NULL
+        || trDArrayReserve(pike->currentList, stateCount) == 0 || trDArrayReserve(pike->nextList, stateCount) == 0)
+    {
+        trPikeDelete(pike);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+    Function to run pike VM, all thread run together like state set simulation but each thread carry
+    it's own group position, thread order keep priority of backtracking. When not anchored, new thread
+    start at every position until leftmost match found, then thread with lower priority than the
+    matched one is dropped. Thread that couldn't reach END anymore (pike's live map) is dropped too,
+    so search stop right at the end of match and the next search from there doesn't read the input again
+    @param regex : compiled regex
+    @param pike : working memory from trPikeInit
+    @param string : string to be checked
+    @param length : length of string
+    @param start : position to start matching
+    @param anchored : 1 if match must start at start and end at length, 0 to search match anywhere after start
+    @param groups : array of 2 * groupCount int to store start and end of every group (all -1)
+    @return MATCH if pattern match, NO_MATCH if not
+*/
+int trPikeRun(const TRegex *regex, TRPike *pike, const char *string, int length, int start, int anchored, int *groups)
+{
+    int slotCount = regex->groupCount * 2;
+    int result = NO_MATCH;
+
+    trDArrayMakeEmpty(pike->currentList);
+    pike->generation += 1;
+    int pos = start;
+    for (; pos <= length; pos++)
+    {
+        if (trDArrayGetSize(pike->currentList) == 0 && (result == MATCH || (anchored == 1 && pos > start)))
+        {
+            break;
+        }
+
+        if ((anchored == 0 && result == NO_MATCH) || pos == start)
+        {
+            // without running thread, skip character that couldn't start a match
+            while (anchored == 0 && trDArrayGetSize(pike->currentList) == 0 && regex->minLength > 0 && pos < length && trByteSetHas(regex->firstBytes, string[pos]) == 0)
+            {
+                pos += 1;
+            }
+            memcpy(pike->threadGroups, groups, sizeof(int) * slotCount);
+            trPikeAdd(pike->currentList, pike->currentGroups, regex->startingState, pos, pike->threadGroups, slotCount, pike->mark, pike->generation);
+        }
+
+        // first END thread has highest priority, thread after it is dropped
+        for (int i = 0; i < trDArrayGetSize(pike->currentList) && (anchored == 0 || pos == length); i++)
+        {
+            if (trDArrayGetType(trDArrayGetElement(pike->currentList, i)) == END)
+            {
+                memcpy(groups, pike->currentGroups + i * slotCount, sizeof(int) * slotCount);
+                result = MATCH;
+                while (trDArrayGetSize(pike->currentList) > i)
+                {
+                    trDArrayPop(pike->currentList);
+                }
+            }
+        }
+        if (pos == length)
+        {
+            break;
+        }
+
+        pike->generation += 1;
+        trDArrayMakeEmpty(pike->nextList);
+        for (int i = 0; i < trDArrayGetSize(pike->currentList); i++)
+        {
+            TRDArray *state = trDArrayGetElement(pike->currentList, i);
+            if (trDArrayMatchByte(state, string[pos]) == 1 && (pike->live == NULL || trLiveHas(regex, pike->live, string, state, pos) == 1))
+            {
+                memcpy(pike->threadGroups, pike->currentGroups + i * slotCount, sizeof(int) * slotCount);
+                for (int j = 0; j < trDArrayGetSize(state); j++)
+                {
+                    trPikeAdd(pike->nextList, pike->nextGroups, trDArrayGetElement(state, j), pos + 1, pike->threadGroups, slotCount, pike->mark, pike->generation);
+                }
+            }
+        }
+
+        TRDArray *temp = pike->currentList;
+        pike->currentList = pike->nextList;
+        pike->nextList = temp;
+        int *tempGroups = pike->currentGroups;
+        pike->currentGroups = pike->nextGroups;
+        pike->nextGroups = tempGroups;
+    }
+    pike->stopped = pos > length ? length : pos;
+    return result;
+}
+
+/**
+    Function to count string read again by search that went past the end of it's match, when it's more than
+    length of string live map is made so the next search stop at the end of match and search of every match
+    together stay linear to length of string (live map cost is only paid by pattern that need it)
+    @param regex : compiled regex
+    @param pike : working memory that just searched string
+    @param string : string being searched
+    @param length : length of string
+    @param next : position where next search start
+    @param reread : string read again so far, increased by this function (reset when live map is tried)
+*/
+void trPikeCountReread(const TRegex *regex, TRPike *pike, const char *string, int length, int next, long *reread)
+{
+    if (pike->live != NULL)
+    {
+        return;
+    }
+    *reread += pike->stopped > next ? pike->stopped - next : 0;
+    if (*reread > length)
+    {
+        // without live map matching is still right, only slower
+        pike->live = trLiveInit(regex, string, length);
+        *reread = 0;
+    }
+}
+
+/**
+    Function to match regex with group by pike VM
+    @param regex : compiled regex
+    @param string : string to be checked
+    @param length : length of string
+    @param groups : array of 2 * groupCount int to store start and end of every group (all -1)
+    @return MATCH if pattern match, NO_MATCH if not, NO_MEMORY if allocator failed
+*/
+int tRegexMatchPike(const TRegex *regex, const char *string, int length, int *groups)
+{
+    TRPike pike;
+    if (trPikeInit(&pike, regex) == 0)
+    {
+        return NO_MEMORY;
+    }
+    int result = trPikeRun(regex, &pike, string, length, 0, 1, groups);
+    trPikeDelete(&pike);
+    return result;
+}
+
+/**
+    Function to get number of group of compiled regex, group 0 is whole pattern and group i is i-th '('
+    @param regex : compiled regex
+    @return number of group
+*/
+int tRegexGroupCount(const TRegex *regex)
+{
+    return regex->groupCount;
+}
+
+/**
+    Function to compare pattern of string with regex and get where every group start and end,
+    use one pass matching if regex allow it, otherwise pike VM
+    @param regex : compiled regex
+    @param string : string to check is it match with regex (doesn't need NUL terminator)
+    @param length : length of string
+    @param groups : array of 2 * tRegexGroupCount(regex) int, groups[2i] and groups[2i+1] is start and end
+                    of group i, -1 if group not matched
+    @return MATCH if pattern match, NO_MATCH if not, TOO_LONG if length is bigger than INT_MAX,
+            NO_MEMORY if allocator failed
+*/
+int tRegexMatchGroups(const TRegex *regex, const char *string, size_t length, int *groups)
+{
+    if (regex->stateList == NULL)
+    {
+        return NO_MATCH;
+    }
+    if (length > INT_MAX)
+    {
+        return TOO_LONG;
+    }
+
+    for (int i = 0; i < regex->groupCount * 2; i++)
+    {
+        groups[i] = -1;
+    }
+    if (tRegexQuickCheck(regex, string, (int)length) == NO_MATCH)
+    {
+        return NO_MATCH;
+    }
+    else if (regex->onePass == 1)
+    {
+        return tRegexMatchOnePass(regex, string, (int)length, groups);
+    }
+    return tRegexMatchPike(regex, string, (int)length, groups);
+}
+
+/**
+    Byte sequence of every valid UTF-8 character, each row is one alternative as pair of lowest and highest byte
+*/
+unsigned char trUtf8Sequence[9][8] = {
+    {0x00, 0x7F},
+    {0xC2, 0xDF, 0x80, 0xBF},
+    {0xE0, 0xE0, 0xA0, 0xBF, 0x80, 0xBF},
+    {0xE1, 0xEC, 0x80, 0xBF, 0x80, 0xBF},
+    {0xED, 0xED, 0x80, 0x9F, 0x80, 0xBF},
+    {0xEE, 0xEF, 0x80, 0xBF, 0x80, 0xBF},
+    {0xF0, 0xF0, 0x90, 0xBF, 0x80, 0xBF, 0x80, 0xBF},
+    {0xF1, 0xF3, 0x80, 0xBF, 0x80, 0xBF, 0x80, 0xBF},
+    {0xF4, 0xF4, 0x80, 0x8F, 0x80, 0xBF, 0x80, 0xBF}
+};
+int trUtf8SequenceLength[9] = {1, 2, 3, 3, 3, 3, 4, 4, 4};
+
+/**
+    Function to push node consuming one UTF-8 character, it's group ('[' and ']' not captured) of
+    alternative byte sequence so it's matched byte by byte without decoding
+    @param graphNode : dynamic array of node to store all state
+*/
+void convertUtf8Anything(TRDArray *graphNode)
+{
+    trDArrayPush(graphNode, trDArrayInit('[', SYMBOL));
+    for (int i = 0; i < 9; i++)
+    {
+        if (i > 0)
+        {
+            trDArrayPush(graphNode, trDArrayInit('|', SYMBOL));
+        }
+        for (int j = 0; j < trUtf8SequenceLength[i]; j++)
+        {
+            unsigned char low = trUtf8Sequence[i][j * 2];
+            unsigned char high = trUtf8Sequence[i][j * 2 + 1];
+            TRDArray *node = trDArrayInit((char)low, low == high ? NORMAL : RANGE);
+            node->dataEnd = (char)high;
+            trDArrayPush(graphNode, node);
+        }
+    }
+    trDArrayPush(graphNode, trDArrayInit(']', SYMBOL));
+}
+
+/**
+    Function to write replacement of one match to output, $n is replaced by group n and $$ by $
+    @param replacement : replacement string
+    @param input : string being replaced
+    @param groups : group position of the match
+    @param groupCount : number of group
+    @param output : output buffer
+    @param capacity : capacity of output buffer
+    @param written : number of character already in output (even if not fit), increased by this function
+*/
+void trReplaceWrite(const char *replacement, const char *input, const int *groups, int groupCount, char *output, size_t capacity, size_t *written)
+{
+    for (int i = 0; replacement[i] != 0; i++)
+    {
+        const char *copy = replacement + i;
+        size_t copyLength = 1;
+        if (replacement[i] == '$' && replacement[i + 1] == '$')
+        {
+            i += 1;
+        }
+        else if (replacement[i] == '$' && replacement[i + 1] >= '0' && replacement[i + 1] <= '9')
+        {
+            int group = 0;
+            while (replacement[i + 1] >= '0' && replacement[i + 1] <= '9')
+            {
+                group = group * 10 + replacement[i + 1] - '0';
+                i += 1;
+            }
+            copyLength = 0;
+            if (group < groupCount && groups[group * 2] >= 0)
+            {
+                copy = input + groups[group * 2];
+                copyLength = groups[group * 2 + 1] - groups[group * 2];
+            }
+        }
+
+        for (size_t j = 0; j < copyLength; j++)
+        {
+            if (*written + 1 < capacity)
+            {
+                output[*written] = copy[j];
+            }
+            *written += 1;
+        }
+    }
+}
+
+/**
+    Function to replace every match of regex in input, matching is leftmost first and match never overlap,
+    output is always NUL terminated if capacity > 0 (cut if it doesn't fit), regex that isn't compiled
+    never match so input is copied as it is. Time is linear to length of input (see trPikeCountReread)
+    @param regex : compiled regex
+    @param input : string to be replaced (doesn't need NUL terminator)
+    @param length : length of input
+    @param replacement : replacement string, $n is replaced by group n and $$ by $
+    @param output : buffer for result
+    @param capacity : capacity of output buffer
+    @return length of whole result (bigger or same as capacity if result was cut), SIZE_MAX (output empty)
+            if length is bigger than INT_MAX or allocator failed
+*/
+size_t tRegexReplaceAll(const TRegex *regex, const char *input, size_t length, const char *replacement, char *output, size_t capacity)
+{
+    if (length > INT_MAX)
+    {
+        if (capacity > 0)
+        {
+            output[0] = 0;
+        }
+        return SIZE_MAX;
+    }
+
+    size_t written = 0;
+    if (regex->stateList == NULL)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            if (written + 1 < capacity)
+            {
+                output[written] = input[i];
+            }
+            written += 1;
+        }
+        if (capacity > 0)
+        {
+            output[written < capacity ? written : capacity - 1] = 0;
+        }
+        return written;
+    }
+
+    int pos = 0;
+    int slotCount = regex->groupCount * 2;
+
+    TRPike pike;
+    int *groups = (int*)trMemoryAlloc(sizeof(int) * slotCount + 1);
+    if (groups == NULL || trPikeInit(&pike, regex) == 0)
+    {
+        trMemoryFree(groups);
+        if (capacity > 0)
+        {
+            output[0] = 0;
+        }
+        return SIZE_MAX;
+    }
+    long reread = 0;
+    while (pos <= (int)length)
+    {
+        trPikeCountReread(regex, &pike, input, (int)length, pos, &reread);
+        for (int i = 0; i < slotCount; i++)
+        {
+            groups[i] = -1;
+        }
+
+        int matched = trPikeRun(regex, &pike, input, (int)length, pos, 0, groups) == MATCH;
+        int end = matched == 1 ? groups[0] : (int)length;
+        for (; pos < end; pos++)
+        {
+            if (written + 1 < capacity)
+            {
+                output[written] = input[pos];
+            }
+            written += 1;
+        }
+        if (matched == 0)
+        {
+            break;
+        }
+
+        trReplaceWrite(replacement, input, groups, regex->groupCount, output, capacity, &written);
+        pos = groups[1];
+        if (groups[0] == groups[1])
+        {
+            // empty match, copy next character so the same position is not matched again
+            if (pos < (int)length)
+            {
+                if (written + 1 < capacity)
+                {
+                    output[written] = input[pos];
+                }
+                written += 1;
+            }
+            pos += 1;
+        }
+    }
+    trMemoryFree(groups);
+    trPikeDelete(&pike);
+
+    if (capacity > 0)
+    {
+        output[written < capacity ? written : capacity - 1] = 0;
+    }
+    return written;
+}
+
+/**
+    Function to split input by every match of regex, span point to input (nothing is copied),
+    empty match doesn't split, regex that isn't compiled never match so whole input is one span.
+    Time is linear to length of input (see trPikeCountReread)
+    @param regex : compiled regex
+    @param input : string to be split (doesn't need NUL terminator)
+    @param length : length of input
+    @param spans : array to store span between match
+    @param capacity : capacity of spans
+    @return number of span (bigger than capacity if not all span fit), -1 if length is bigger than INT_MAX
+            or allocator failed
+*/
+int tRegexSplit(const TRegex *regex, const char *input, size_t length, TRSlice *spans, int capacity)
+{
+    if (length > INT_MAX)
+    {
+        return -1;
+    }
+    if (regex->stateList == NULL)
+    {
+        if (capacity > 0)
+        {
+            spans[0].data = input;
+            spans[0].length = length;
+        }
+        return 1;
+    }
+
+    int count = 0;
+    int pos = 0;
+    int spanStart = 0;
+    int slotCount = regex->groupCount * 2;
+
+    TRPike pike;
+    int *groups = (int*)trMemoryAlloc(sizeof(int) * slotCount + 1);
+    if (groups == NULL || trPikeInit(&pike, regex) == 0)
+    {
+        trMemoryFree(groups);
+        return -1;
+    }
+    long reread = 0;
+    while (pos <= (int)length)
+    {
+        trPikeCountReread(regex, &pike, input, (int)length, pos, &reread);
+        for (int i = 0; i < slotCount; i++)
+        {
+            groups[i] = -1;
+        }
+        if (trPikeRun(regex, &pike, input, (int)length, pos, 0, groups) == NO_MATCH)
+        {
+            break;
+        }
+        if (groups[0] == groups[1])
+        {
+            pos = groups[1] + 1;
+            continue;
+        }
+
+        if (count < capacity)
+        {
+            spans[count].data = input + spanStart;
+            spans[count].length = groups[0] - spanStart;
+        }
+        count += 1;
+        spanStart = groups[1];
+        pos = groups[1];
+    }
+    if (count < capacity)
+    {
+        spans[count].data = input + spanStart;
+        spans[count].length = length - spanStart;
+    }
+    count += 1;
+
+    trMemoryFree(groups);
+    trPikeDelete(&pike);
+    return count;
+}
+
+/**
+    Function to convert code of regex's notation to state node
+    @param code : code that will be converted
+    @param graphNode : dynamic array of node to store all state
+    @param flags : compile flag of regex
+*/
+void convertCode(char *code, TRDArray *graphNode, int flags)
+{
+    int position = 0;
+    int length = strlen(code);
+    int bracket = 0;
+    while(position < length)
+    {
+        if (code[position] == '\\')
+        {
+            position += 1;
+            if (code[position] == 'w')
+            {
+                trDArrayPush(graphNode, trDArrayInit('w', LETTERS));
+            }
+            else if (code[position] == 'd')
+            {
+                trDArrayPush(graphNode, trDArrayInit('d', NUMBERS));
+            }
+            else
+            {
+                trDArrayPush(graphNode, trDArrayInitCharacter(code[position], flags));
+            }
+        }
+        else if (code[position] == '(' || code[position] == ')' || code[position] == '*' || code[position] == '|' || code[position] == '+' || code[position] == '?')
+        {
+            trDArrayPush(graphNode, trDArrayInit(code[position], SYMBOL));
+        }
+        else if (code[position] == '.' && (flags & FLAG_UTF8) != 0)
+        {
+            convertUtf8Anything(graphNode);
+        }
+        else if (code[position] == '.')
+        {
+            trDArrayPush(graphNode, trDArrayInit(code[position], ANYTHING));
+        }
+        else if ((unsigned char)code[position] >= 0xC0 && (flags & FLAG_UTF8) != 0)
+        {
+            // multi-byte character become one group so quantifier after it repeat the whole character
+            int sequenceLength = 1;
+            while (sequenceLength < 4 && ((unsigned char)code[position + sequenceLength] & 0xC0) == 0x80)
+            {
+                sequenceLength += 1;
+            }
+            char next = code[position + sequenceLength];
+            int quantified = next == '*' || next == '+' || next == '?';
+
+            if (quantified == 1)
+            {
+                trDArrayPush(graphNode, trDArrayInit('[', SYMBOL));
+            }
+            for (int i = 0; i < sequenceLength; i++)
+            {
+                trDArrayPush(graphNode, trDArrayInit(code[position + i], NORMAL));
+            }
+            if (quantified == 1)
+            {
+                trDArrayPush(graphNode, trDArrayInit(']', SYMBOL));
+            }
+            position += sequenceLength - 1;
+        }
+        else
+        {
+            trDArrayPush(graphNode, trDArrayInitCharacter(code[position], flags));
+        }
+
+        position++;
+    }
+}
+
+/**
+    Function to check if two state consume (or do) the same thing
+    @param first : first state
+    @param second : second state
+    @return 1 if both state have same type, data and group, 0 if not
+*/
+int trDArraySameLabel(TRDArray *first, TRDArray *second)
+{
+    return trDArrayGetType(first) == trDArrayGetType(second) && trDArrayGetData(first) == trDArrayGetData(second) && first->dataEnd == second->dataEnd
+           && trDArrayGetGroup(first) == trDArrayGetGroup(second);
+}
+
+/**
+    Function to find index of state in next-state-array
+    @param array : state holding the next-state-array
+    @param state : state to be found
+    @return index of state, -1 if not found
+*/
+int trDArrayFind(TRDArray *array, TRDArray *state)
+{
+    for (int i = 0; i < trDArrayGetSize(array); i++)
+    {
+        if (trDArrayGetElement(array, i) == state)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+    Function to check if branch between two branch of the same state could take the same character
+    (or end the match) as them, then moving the later one next to the earlier one would make it
+    tried before the branch between and change which match is found first
+    @param parent : state holding the branch
+    @param first : index of earlier branch
+    @param second : index of later branch
+    @param closure : array to store state reached from branch between
+    @param mark : last generation each state id added to closure
+    @param generation : generation of this check
+    @return 1 if any branch between could take the same character or reach END, 0 if not
+*/
+int trFactorBlocked(TRDArray *parent, int first, int second, TRDArray *closure, int *mark, int generation)
+{
+    trDArrayMakeEmpty(closure);
+    for (int i = first + 1; i < second; i++)
+    {
+        trStateSetAdd(closure, trDArrayGetElement(parent, i), mark, generation);
+    }
+    for (int i = 0; i < trDArrayGetSize(closure); i++)
+    {
+        TRDArray *state = trDArrayGetElement(closure, i);
+        if (trDArrayGetType(state) == END)
+        {
+            return 1;
+        }
+        for (int c = 0; c < 256; c++)
+        {
+            if (trDArrayMatchByte(state, (char)c) == 1 && trDArrayMatchByte(trDArrayGetElement(parent, first), (char)c) == 1)
+            {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+    Function to merge branch sharing same prefix into trie, if a state has two next state consuming the
+    same thing and both only reached from that state, second one is merged to the first one
+    so every character take at most one branch for each prefix. Branch is only merged when no branch
+    between them could take the same character, so leftmost first priority (and every match and group
+    position) stay the same
+    @param regex : regex with stateList, merged state in stateList is set to NULL
+*/
+void tRegexFactorPrefix(TRegex *regex)
+{
+    int stateCount = trDArrayGetSize(regex->stateList);
+    int *predecessor = (int*)trMemoryCalloc(stateCount, sizeof(int));
+    int *mark = (int*)trMemoryCalloc(stateCount, sizeof(int));
+    TRDArray *closure = trDArrayInit(0, EMPTY);
+    int generation = 0;
+    for (int i = 0; i < stateCount; i++)
+    {
+        TRDArray *state = trDArrayGetElement(regex->stateList, i);
+        for (int j = 0; j < trDArrayGetSize(state); j++)
+        {
+            predecessor[trDArrayGetElement(state, j)->id] += 1;
+        }
+    }
+
+    int changed = 1;
+    while (changed == 1)
+    {
+        changed = 0;
+        for (int p = 0; p < stateCount; p++)
+        {
+            TRDArray *parent = trDArrayGetElement(regex->stateList, p);
+            for (int i = 0; parent != NULL && i < trDArrayGetSize(parent); i++)
+            {
+                TRDArray *first = trDArrayGetElement(parent, i);
+                if (trDArrayIsEpsilon(first) == 1 || trDArrayGetType(first) == END || predecessor[first->id] != 1)
+                {
+                    continue;
+                }
+
+                for (int j = i + 1; j < trDArrayGetSize(parent); j++)
+                {
+                    TRDArray *second = trDArrayGetElement(parent, j);
+                    if (second == first || second == parent || predecessor[second->id] != 1 || trDArraySameLabel(first, second) == 0)
+                    {
+                        continue;
+                    }
+                    generation += 1;
+                    if (trFactorBlocked(parent, i, j, closure, mark, generation) == 1)
+                    {
+                        break;
+                    }
+
+                    for (int k = 0; k < trDArrayGetSize(second); k++)
+                    {
+                        TRDArray *next = trDArrayGetElement(second, k);
+                        if (trDArrayFind(first, next) == -1)
+                        {
+                            trDArrayPush(first, next);
+                        }
+                        else
+                        {
+                            predecessor[next->id] -= 1;
+                        }
+                    }
+                    trDArrayRemove(parent, j);
+                    trDArraySetElement(regex->stateList, NULL, second->id);
+                    trDArrayDelete(second);
+                    j -= 1;
+                    changed = 1;
+                }
+            }
+        }
+    }
+    trDArrayDelete(closure);
+    trMemoryFree(mark);
+    trMemoryFree(predecessor);
+}
+
+/**
+    Function to compare two state by label then by next state, used to sort state in tRegexFactorSuffix
+    @param first : pointer to first state
+    @param second : pointer to second state
+    @return negative, 0 or positive like strcmp
+*/
+int trDArrayCompareSuffix(const void *first, const void *second)
+{
+    TRDArray *a = *(TRDArray**)first;
+    TRDArray *b = *(TRDArray**)second;
+    if (trDArrayGetType(a) != trDArrayGetType(b))
+    {
+        return trDArrayGetType(a) - trDArrayGetType(b);
+    }
+    if (trDArrayGetData(a) != trDArrayGetData(b))
+    {
+        return trDArrayGetData(a) - trDArrayGetData(b);
+    }
+    if (a->dataEnd != b->dataEnd)
+    {
+        return a->dataEnd - b->dataEnd;
+    }
+    if (trDArrayGetGroup(a) != trDArrayGetGroup(b))
+    {
+        return trDArrayGetGroup(a) - trDArrayGetGroup(b);
+    }
+    if (trDArrayGetSize(a) != trDArrayGetSize(b))
+    {
+        return trDArrayGetSize(a) - trDArrayGetSize(b);
+    }
+    for (int i = 0; i < trDArrayGetSize(a); i++)
+    {
+        if (trDArrayGetElement(a, i)->id != trDArrayGetElement(b, i)->id)
+        {
+            return trDArrayGetElement(a, i)->id - trDArrayGetElement(b, i)->id;
+        }
+    }
+    return 0;
+}
+
+/**
+    Function to merge state sharing same suffix, two state with same label and same next state
+    (in same order) match exactly the same thing so all edge to the second one moved to the first one
+    @param regex : regex with stateList, merged state in stateList is set to NULL
+*/
+void tRegexFactorSuffix(TRegex *regex)
+{
+    int stateCount = trDArrayGetSize(regex->stateList);
+    TRDArray **sorted = (TRDArray**)trMemoryAlloc(sizeof(TRDArray*) * stateCount + 1);
+    TRDArray **replacement = (TRDArray**)trMemoryCalloc(stateCount + 1, sizeof(TRDArray*));
+
+    int changed = 1;
+    while (changed == 1)
+    {
+        changed = 0;
+        int sortedCount = 0;
+        for (int i = 0; i < stateCount; i++)
+        {
+            TRDArray *state = trDArrayGetElement(regex->stateList, i);
+            if (state != NULL && state != regex->startingState)
+            {
+                sorted[sortedCount] = state;
+                sortedCount += 1;
+            }
+        }
+        qsort(sorted, sortedCount, sizeof(TRDArray*), trDArrayCompareSuffix);
+
+        for (int i = 1; i < sortedCount; i++)
+        {
+            if (trDArrayCompareSuffix(&sorted[i - 1], &sorted[i]) == 0)
+            {
+                replacement[sorted[i]->id] = replacement[sorted[i - 1]->id] != NULL ? replacement[sorted[i - 1]->id] : sorted[i - 1];
+                changed = 1;
+            }
+        }
+        if (changed == 0)
+        {
+            break;
+        }
+
+        // move edge to the kept state, remove edge that become duplicate
+        for (int i = 0; i < stateCount; i++)
+        {
+            TRDArray *state = trDArrayGetElement(regex->stateList, i);
+            if (state == NULL || replacement[i] != NULL)
+            {
+                continue;
+            }
+            for (int j = 0; j < trDArrayGetSize(state); j++)
+            {
+                TRDArray *next = trDArrayGetElement(state, j);
+                if (replacement[next->id] != NULL)
+                {
+                    next = replacement[next->id];
+                    trDArraySetElement(state, next, j);
+                }
+                if (trDArrayFind(state, next) < j)
+                {
+                    trDArrayRemove(state, j);
+                    j -= 1;
+                }
+            }
+        }
+        for (int i = 0; i < stateCount; i++)
+        {
+            if (replacement[i] != NULL)
+            {
+                trDArrayDelete(trDArrayGetElement(regex->stateList, i));
+                trDArraySetElement(regex->stateList, NULL, i);
+                replacement[i] = NULL;
+            }
+        }
+    }
+
+    trMemoryFree(replacement);
+    trMemoryFree(sorted);
+}
+
+/**
+    Function to make graph smaller by merging alternation branch with same prefix and same suffix,
+    stateList is collected again after merging
+    @param regex : regex with stateList
+*/
+void tRegexFactor(TRegex *regex)
+{
+    tRegexFactorPrefix(regex);
+    tRegexFactorSuffix(regex);
+    trDArrayDelete(regex->stateList);
+    regex->stateList = trDArrayCollectAll(regex->startingState);
+}
+
+/**
+    Function to roughly estimate memory needed to compile regex string notation, every character could become
+    one node and one extra empty node, each with next-state-array of default capacity. It's not an upper bound
+    (working memory of compile is not counted), memory budget is checked on every allocation instead
+    @param code : regex string notation
+    @param flags : compile flag of regex
+    @return estimated bytes
+*/
+size_t tRegexEstimateCompileMemory(char *code, int flags)
+{
+    size_t nodeCount = (strlen(code) + 3) * 2;
+    for (int i = 0; code[i] != 0 && (flags & FLAG_UTF8) != 0; i++)
+    {
+        // '.' become 27 byte node in 9 alternative, with it's symbol and empty node about 60 node
+        nodeCount += code[i] == '.' ? 60 : 2;
+    }
+    return nodeCount * (2 * sizeof(TRMemoryHeader) + sizeof(TRDArray) + 2 * sizeof(TRDArray*));
+}
+
+/**
+    Function to finish compile guard of this thread, when compile failed every block allocated
+    while compiling is freed and starting state is left without next state
+    @param regex : regex being compiled
+    @param compiled : 1 if compile succeeded, 0 if failed
+*/
+void trCompileGuardRelease(TRegex *regex, int compiled)
+{
+    trCompileGuard.active = 0;
+    if (compiled == 0)
+    {
+        // starting state is owned by regex, keep it's next-state-array even if it was grown while compiling
+        TRMemoryHeader *header = (TRMemoryHeader*)regex->startingState->nextState - 1;
+        if (header->info.slot < trCompileGuard.count && trCompileGuard.blocks[header->info.slot] == regex->startingState->nextState)
+        {
+            trCompileGuard.blocks[header->info.slot] = NULL;
+        }
+        regex->startingState->size = 0;
+        regex->startingState->visited = 0;
+        regex->stateList = NULL;
+        for (size_t i = 0; i < trCompileGuard.count; i++)
+        {
+            trMemoryFree(trCompileGuard.blocks[i]);
+        }
+    }
+    tRegexFreeFunc(trCompileGuard.blocks);
+    trCompileGuard.blocks = NULL;
+    trCompileGuard.count = 0;
+    trCompileGuard.capacity = 0;
+}
+
+/**
+    Function to build regex graph from regex string notation, every allocation failure jump back to tRegexCompile
+    @param regex : regex to be compiled
+*/
+void trCompileGraph(TRegex *regex)
+{
+    char appendedCode[257] = "";
+    strcpy(appendedCode, "(");
+    strcat(appendedCode, regex->code);
+    strcat(appendedCode, ")");
+
+    TRDArray *allGraphNode = trDArrayInit(0, EMPTY);
+    convertCode(appendedCode, allGraphNode, regex->flags);
+
+//        TRDArray *currentState = trDArrayInit(0);
+//        TRDArray *nextState = trDArrayInit(0);
+//        TRDArray *endState = trDArrayInit(0);
+//        trDArrayPush(currentState, regex->startingState);
+//        int start = 0;
+//        dummy2(currentState, nextState, endState, allGraphNode, &start);
+
+    TRDArray *nextState = trDArrayInit(0, EMPTY);
+    TRDArray *endState = trDArrayInit(0, EMPTY);
+//        trDArrayPush(endState, regex->startingState);
+    int start = 0;
+    int groupCount = 0;
+    tRegexCompileFuncRec(nextState, endState, allGraphNode, &start, &groupCount);
+    for (int i = 0; i < trDArrayGetSize(nextState); i++)
+    {
+        trDArrayPush(regex->startingState, trDArrayGetElement(nextState, i));
+    }
+
+    TRDArray *endStateNode = trDArrayInit(0, END);
+    for (int i = 0; i < trDArrayGetSize(endState); i++)
+    {
+        trDArrayPush(trDArrayGetElement(endState, i), endStateNode);
+    }
+
+
+    //int pos = 0;
+    //tRegexCompileFuncRec(regex->startingState, appendedCode, &pos, strlen(appendedCode));
+
+    // symbol never become part of graph
+    for (int i = 0; i < trDArrayGetSize(allGraphNode); i++)
+    {
+        if (trDArrayGetType(trDArrayGetElement(allGraphNode, i)) == SYMBOL)
+        {
+            trDArrayDelete(trDArrayGetElement(allGraphNode, i));
+        }
+    }
+    trDArrayDelete(allGraphNode);
+    trDArrayDelete(nextState);
+    trDArrayDelete(endState);
+    regex->stateList = trDArrayCollectAll(regex->startingState);
+    tRegexFactor(regex);
+    regex->groupCount = groupCount;
+    regex->onePass = tRegexIsOnePass(regex);
+    tRegexAnalyze(regex);
+}
+
+/**
+    Function to compile regex graph from regex string notation
+    @param regex : regex to be compiled
+    @return 1 if compiled, 0 if compiling would go over memory budget or allocator failed (regex stay not compiled)
+*/
+int tRegexCompile(TRegex *regex)
+{
+    if (tRegexIsCompiled(regex) == 0)
+    {
+        if (regex->startingState == NULL && (regex->startingState = trDArrayInit(0, START)) == NULL)
+        {
+            return 0;
+        }
+
+        trCompileGuard.active = 1;
+        if (setjmp(trCompileGuard.failure) != 0)
+        {
+            trCompileGuardRelease(regex, 0);
+            return 0;
+        }
+        trCompileGraph(regex);
+        trCompileGuardRelease(regex, 1);
+        regex->compiled = 1;
+    }
+    return 1;
+}
+
+/**
+    Mutex used by arena, on platform without pthread everything run in one thread so it do nothing
+*/
+#if !defined(_WIN32)
+typedef pthread_mutex_t TRMutex;
+#else
+typedef int TRMutex;
+#endif
+
+void trMutexInit(TRMutex *mutex)
+{
+#if !defined(_WIN32)
+    pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+void trMutexLock(TRMutex *mutex)
+{
+#if !defined(_WIN32)
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+void trMutexUnlock(TRMutex *mutex)
+{
+#if !defined(_WIN32)
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+void trMutexDelete(TRMutex *mutex)
+{
+#if !defined(_WIN32)
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+enum {ARENA_SHARDS = 16};
+
+/**
+    One part of arena's hash table of shared state, state is put in shard by it's hash so thread
+    interning different state rarely wait for each other
+    @attribute lock : lock of this shard
+    @attribute slots : open addressing table of shared state (NULL if empty)
+    @attribute capacity : capacity of slots (power of two)
+    @attribute count : number of state in slots
+*/
+typedef struct TRArenaShard
+{
+    TRMutex lock;
+    TRDArray **slots;
+    int capacity;
+    int count;
+} TRArenaShard;
+
+/**
+    Index of arena, shared state could be found by it's label and next state
+    @attribute lock : lock of arena's stateList, fillerList and reserved
+    @attribute shards : hash table of shared state
+    @attribute reserved : capacity of arena's stateList kept for regex still being interned
+*/
+typedef struct TRArenaIndex
+{
+    TRMutex lock;
+    TRArenaShard shards[ARENA_SHARDS];
+    int reserved;
+} TRArenaIndex;
+
+/**
+    Arena owning state of regex compiled together by tRegexCompileMany, sub graph that behave the same
+    in different regex is stored only once
+    @attribute stateList : every state owned by arena
+    @attribute fillerList : empty state that never reached, filler i has id i and fill id not used in regex's stateList
+    @attribute index : hash table of state that could be shared
+*/
+typedef struct TRegexArena
+{
+    TRDArray *stateList;
+    TRDArray *fillerList;
+    TRArenaIndex *index;
+} TRegexArena;
+
+/**
+    Function to initialize empty arena
+    @return initialized arena, every field is NULL if allocator failed (tRegexCompileMany then only compile)
+*/
+TRegexArena tRegexArenaInit()
+{
+    TRegexArena arena;
+    arena.stateList = trDArrayInit(0, EMPTY);
+    arena.fillerList = trDArrayInit(0, EMPTY);
+    arena.index = (TRArenaIndex*)trMemoryAlloc(sizeof(TRArenaIndex));
+    if (arena.stateList == NULL || arena.fillerList == NULL || arena.index == NULL)
+    {
+        trDArrayDelete(arena.stateList);
+        trDArrayDelete(arena.fillerList);
+        trMemoryFree(arena.index);
+        arena.stateList = NULL;
+        arena.fillerList = NULL;
+        arena.index = NULL;
+        return arena;
+    }
+    trMutexInit(&arena.index->lock);
+    arena.index->reserved = 0;
+    for (int i = 0; i < ARENA_SHARDS; i++)
+    {
+        trMutexInit(&arena.index->shards[i].lock);
+        arena.index->shards[i].slots = NULL;
+        arena.index->shards[i].capacity = 0;
+        arena.index->shards[i].count = 0;
+    }
+    return arena;
+}
+
+/**
+    Function to delete arena and all of it's state, regex compiled into it could not be matched anymore
+    (tRegexSetCode could still be called to reuse the regex)
+    @param arena : arena to be deleted
+*/
+void tRegexArenaDelete(TRegexArena *arena)
+{
+    if (arena->index == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < trDArrayGetSize(arena->stateList); i++)
+    {
+        trDArrayDelete(trDArrayGetElement(arena->stateList, i));
+    }
+    for (int i = 0; i < trDArrayGetSize(arena->fillerList); i++)
+    {
+        trDArrayDelete(trDArrayGetElement(arena->fillerList, i));
+    }
+    for (int i = 0; i < ARENA_SHARDS; i++)
+    {
+        trMutexDelete(&arena->index->shards[i].lock);
+        trMemoryFree(arena->index->shards[i].slots);
+    }
+    trMutexDelete(&arena->index->lock);
+    trMemoryFree(arena->index);
+    trDArrayDelete(arena->stateList);
+    trDArrayDelete(arena->fillerList);
+    arena->stateList = NULL;
+    arena->fillerList = NULL;
+    arena->index = NULL;
+}
+
+/**
+    Function to hash state by it's label and address of every next state in order
+    @param state : state to be hashed
+    @return hash of state
+*/
+unsigned int trArenaHash(TRDArray *state)
+{
+    unsigned int hash = trDArrayGetSize(state);
+    hash = hash * 31 + trDArrayGetType(state);
+    hash = hash * 31 + (unsigned char)trDArrayGetData(state);
+    hash = hash * 31 + (unsigned char)state->dataEnd;
+    hash = hash * 31 + trDArrayGetGroup(state);
+    for (int i = 0; i < trDArrayGetSize(state); i++)
+    {
+        uintptr_t next = (uintptr_t)trDArrayGetElement(state, i);
+        hash = hash * 31 + (unsigned int)(next >> 4) + (unsigned int)(next >> 32);
+    }
+    return hash * 2654435761u;
+}
+
+/**
+    Function to check if two state have same label and same next state in same order
+    @param first : first state
+    @param second : second state
+    @return 1 if same, 0 if not
+*/
+int trArenaSameState(TRDArray *first, TRDArray *second)
+{
+    if (trDArrayGetSize(first) != trDArrayGetSize(second) || trDArraySameLabel(first, second) == 0)
+    {
+        return 0;
+    }
+    for (int i = 0; i < trDArrayGetSize(first); i++)
+    {
+        if (trDArrayGetElement(first, i) != trDArrayGetElement(second, i))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+    Function to find shared state same as state, state is added to arena's index if not found
+    @param index : arena's index
+    @param state : state whose every next state is already shared
+    @return shared state, state itself if it's added (or not added because table is full and couldn't grow)
+*/
+TRDArray *trArenaFindOrAdd(TRArenaIndex *index, TRDArray *state)
+{
+    unsigned int hash = trArenaHash(state);
+    TRArenaShard *shard = &index->shards[hash % ARENA_SHARDS];
+    hash /= ARENA_SHARDS;
+
+    trMutexLock(&shard->lock);
+    if ((shard->count + 1) * 2 > shard->capacity)
+    {
+        int capacity = shard->capacity == 0 ? 16 : shard->capacity * 2;
+        TRDArray **slots = (TRDArray**)trMemoryCalloc(capacity, sizeof(TRDArray*));
+        for (int i = 0; i < shard->capacity && slots != NULL; i++)
+        {
+            if (shard->slots[i] != NULL)
+            {
+                unsigned int slot = (trArenaHash(shard->slots[i]) / ARENA_SHARDS) & (capacity - 1);
+                while (slots[slot] != NULL)
+                {
+                    slot = (slot + 1) & (capacity - 1);
+                }
+                slots[slot] = shard->slots[i];
+            }
+        }
+        if (slots != NULL)
+        {
+            trMemoryFree(shard->slots);
+            shard->slots = slots;
+            shard->capacity = capacity;
+        }
+    }
+    if (shard->count + 1 >= shard->capacity)
+    {
+        // at least one slot must stay empty so probing stop, state is only not shared
+        trMutexUnlock(&shard->lock);
+        return state;
+    }
+
+    unsigned int slot = hash & (shard->capacity - 1);
+    while (shard->slots[slot] != NULL && trArenaSameState(shard->slots[slot], state) == 0)
+    {
+        slot = (slot + 1) & (shard->capacity - 1);
+    }
+    if (shard->slots[slot] == NULL)
+    {
+        shard->slots[slot] = state;
+        shard->count += 1;
+    }
+    TRDArray *found = shard->slots[slot];
+    trMutexUnlock(&shard->lock);
+    return found;
+}
+
+/**
+    Function to point every next state of state to it's replacement, next state that become the same
+    as earlier one is removed (the earlier one is always tried first so the later never change result)
+    @param state : state to be changed
+    @param firstEdge : index in targets of first next state of state
+    @param targets : original index of every next state of every state
+    @param mapped : replacement of every original state
+    @param shared : 1 if replacement of original state is shared in arena
+    @return 1 if every next state is shared, 0 if not
+*/
+int trArenaRelink(TRDArray *state, int firstEdge, const int *targets, TRDArray **mapped, const unsigned char *shared)
+{
+    int allShared = 1;
+    int edgeCount = trDArrayGetSize(state);
+    trDArrayMakeEmpty(state);
+    for (int j = 0; j < edgeCount; j++)
+    {
+        TRDArray *next = mapped[targets[firstEdge + j]];
+        int duplicate = 0;
+        for (int k = 0; k < trDArrayGetSize(state) && duplicate == 0; k++)
+        {
+            duplicate = trDArrayGetElement(state, k) == next;
+        }
+        if (duplicate == 0)
+        {
+            trDArrayPush(state, next);
+            allShared = allShared && shared[targets[firstEdge + j]];
+        }
+    }
+    return allShared;
+}
+
+/**
+    Function to get smallest id not used yet in regex being interned
+    @param used : 1 for every id already used
+    @param cursor : smallest id that might be free, moved forward
+    @return smallest free id
+*/
+int trArenaFreeId(const unsigned char *used, int *cursor)
+{
+    while (used[*cursor] == 1)
+    {
+        *cursor += 1;
+    }
+    return *cursor;
+}
+
+/**
+    Function to move graph of compiled regex into arena, called by compiling thread right after compile.
+    State that couldn't reach a cycle is visited backward from END, it's next state is pointed to
+    their shared replacement and it become the shared state with same label and next state (stored once
+    for every regex). State id only need to be unique in regex reaching it, so shared state is only used
+    if it's id is still free in this regex, new state get smallest free id, so regex's stateList stay as
+    small as it's own graph (hole filled by filler). State in or before a cycle is kept by this regex
+    @param arena : arena that will own the state
+    @param regex : compiled regex not yet in arena
+    @return 1 if moved into arena, 0 if allocator failed (regex is not changed and still own it's state)
+*/
+int trArenaIntern(TRegexArena *arena, TRegex *regex)
+{
+    int stateCount = trDArrayGetSize(regex->stateList);
+    int start = regex->startingState->id;
+    int *pending = (int*)trMemoryAlloc(sizeof(int) * stateCount + 1);
+    int *edgeStart = (int*)trMemoryAlloc(sizeof(int) * (stateCount + 1));
+    int *predecessorStart = (int*)trMemoryCalloc(stateCount + 2, sizeof(int));
+    TRDArray **mapped = (TRDArray**)trMemoryAlloc(sizeof(TRDArray*) * stateCount + 1);
+    unsigned char *shared = (unsigned char*)trMemoryCalloc(stateCount + 1, 1);
+    unsigned char *used = (unsigned char*)trMemoryCalloc(stateCount + 1, 1);
+    TRDArray **byId = (TRDArray**)trMemoryAlloc(sizeof(TRDArray*) * stateCount + 1);
+    int *order = (int*)trMemoryAlloc(sizeof(int) * stateCount + 1);
+    int *targets = NULL;
+    int *predecessor = NULL;
+    TRDArray *owned = trDArrayInit(0, EMPTY);
+    int reserved = 0;
+
+    // everything that could fail is allocated before any state is changed
+    if (pending != NULL && edgeStart != NULL && predecessorStart != NULL && mapped != NULL && shared != NULL
+        && used != NULL && byId != NULL && order != NULL && owned != NULL && trDArrayReserve(owned, stateCount) == 1)
+    {
+        trMutexLock(&arena->index->lock);
+        reserved = trDArrayReserve(arena->stateList, trDArrayGetSize(arena->stateList) + arena->index->reserved + stateCount);
+        while (reserved == 1 && trDArrayGetSize(arena->fillerList) < stateCount)
+        {
+            TRDArray *filler = trDArrayInit(0, EMPTY);
+            if (filler == NULL || trDArrayPush(arena->fillerList, filler) == 0)
+            {
+                trDArrayDelete(filler);
+                reserved = 0;
+                break;
+            }
+            filler->id = trDArrayGetSize(arena->fillerList) - 1;
+        }
+        if (reserved == 1)
+        {
+            arena->index->reserved += stateCount;
+        }
+        trMutexUnlock(&arena->index->lock);
+    }
+    if (reserved == 1)
+    {
+        int edgeCount = 0;
+        for (int i = 0; i < stateCount; i++)
+        {
+            edgeCount += trDArrayGetSize(trDArrayGetElement(regex->stateList, i));
+        }
+        targets = (int*)trMemoryAlloc(sizeof(int) * edgeCount + 1);
+        predecessor = (int*)trMemoryAlloc(sizeof(int) * edgeCount + 1);
+    }
+    if (targets == NULL || predecessor == NULL)
+    {
+        if (reserved == 1)
+        {
+            trMutexLock(&arena->index->lock);
+            arena->index->reserved -= stateCount;
+            trMutexUnlock(&arena->index->lock);
+        }
+        trDArrayDelete(owned);
+        trMemoryFree(predecessor);
+        trMemoryFree(targets);
+        trMemoryFree(order);
+        trMemoryFree(byId);
+        trMemoryFree(used);
+        trMemoryFree(shared);
+        trMemoryFree(mapped);
+        trMemoryFree(predecessorStart);
+        trMemoryFree(edgeStart);
+        trMemoryFree(pending);
+        return 0;
+    }
+
+    // next state is remembered by original id, id of state already replaced could change
+    edgeStart[0] = 0;
+    for (int i = 0; i < stateCount; i++)
+    {
+        TRDArray *state = trDArrayGetElement(regex->stateList, i);
+        pending[i] = trDArrayGetSize(state);
+        edgeStart[i + 1] = edgeStart[i] + trDArrayGetSize(state);
+        mapped[i] = state;
+        for (int j = 0; j < trDArrayGetSize(state); j++)
+        {
+            predecessorStart[trDArrayGetElement(state, j)->id + 2] += 1;
+        }
+    }
+    for (int i = 0; i < stateCount; i++)
+    {
+        predecessorStart[i + 2] += predecessorStart[i + 1];
+    }
+    for (int i = 0; i < stateCount; i++)
     {
-        if (trDArrayGetType(startingState) == END)
+        TRDArray *state = trDArrayGetElement(regex->stateList, i);
+        for (int j = 0; j < trDArrayGetSize(state); j++)
         {
-            return 1;
+            targets[edgeStart[i] + j] = trDArrayGetElement(state, j)->id;
+            predecessor[predecessorStart[trDArrayGetElement(state, j)->id + 1]++] = i;
         }
-        return 0;
     }
-    else if (trDArrayGetType(startingState) == EMPTY || trDArrayGetType(startingState) == START)
+
+    // state whose every next state is settled is settled too, starting from END
+    int settledCount = 0;
+    for (int i = 0; i < stateCount; i++)
     {
-        int result = 0;
-        for (int i = 0; i < trDArrayGetSize(startingState); i++)
+        if (pending[i] == 0)
         {
-            result = tRegexCompareFuncRec(trDArrayGetElement(startingState, i), string, pos, length);
-            if (result == 1)
-            {
-                return result;
-            }
+            order[settledCount] = i;
+            settledCount += 1;
         }
-        return 0;
     }
-    else if (trDArrayGetType(startingState) == NUMBERS)
+    for (int i = 0; i < settledCount; i++)
     {
-        if (string[pos] >= 48 && string[pos] <= 57)
+        for (int j = predecessorStart[order[i]]; j < predecessorStart[order[i] + 1]; j++)
         {
-            int result = 0;
-            for (int i = 0; i < trDArrayGetSize(startingState); i++)
+            pending[predecessor[j]] -= 1;
+            if (pending[predecessor[j]] == 0)
             {
-                result = tRegexCompareFuncRec(trDArrayGetElement(startingState, i), string, pos+1, length);
-                if (result == 1)
-                {
-                    return result;
-                }
+                order[settledCount] = predecessor[j];
+                settledCount += 1;
             }
         }
-        else
-        {
-            return 0;
-        }
     }
-    else if (trDArrayGetType(startingState) == LETTERS)
+
+    int cursor = 0;
+    for (int i = 0; i < settledCount; i++)
     {
-        if ((string[pos] >= 65 && string[pos] <= 90) || (string[pos] >= 97 && string[pos] <= 122) || string[pos] == '_')
+        int original = order[i];
+        TRDArray *state = mapped[original];
+        int id = trArenaFreeId(used, &cursor);
+        // id is given before state could be seen by other thread
+        state->id = id;
+        if (trArenaRelink(state, edgeStart[original], targets, mapped, shared) == 1)
         {
-            int result = 0;
-            for (int i = 0; i < trDArrayGetSize(startingState); i++)
+            TRDArray *found = trArenaFindOrAdd(arena->index, state);
+            if (found == state)
             {
-                result = tRegexCompareFuncRec(trDArrayGetElement(startingState, i), string, pos+1, length);
-                if (result == 1)
-                {
-                    return result;
-                }
+                shared[original] = 1;
+            }
+            else if (found->id < stateCount && (used[found->id] == 0 || byId[found->id] == found))
+            {
+                // same state could already be used by this regex (like both state of a|a)
+                mapped[original] = found;
+                shared[original] = 1;
+                used[found->id] = 1;
+                byId[found->id] = found;
+                trDArrayDelete(state);
+                continue;
             }
         }
-        else
+        used[id] = 1;
+        byId[id] = state;
+        trDArrayPush(owned, state);
+    }
+    for (int i = 0; i < stateCount; i++)
+    {
+        if (pending[i] > 0)
         {
-            return 0;
+            TRDArray *state = mapped[i];
+            trArenaRelink(state, edgeStart[i], targets, mapped, shared);
+            state->id = trArenaFreeId(used, &cursor);
+            used[state->id] = 1;
+            byId[state->id] = state;
+            trDArrayPush(owned, state);
         }
     }
-    else if (trDArrayGetData(startingState) == string[pos] || trDArrayGetType(startingState) == ANYTHING)
-    {
-        int result = 0;
+    regex->startingState = mapped[start];
 
-//        printf("pos: %c\n", string[pos]);
-        for (int i = 0; i < trDArrayGetSize(startingState); i++)
+    // stateList of regex is indexed by the new id, id not used by regex is filled by filler
+    int idCount = stateCount;
+    while (idCount > 0 && used[idCount - 1] == 0)
+    {
+        idCount -= 1;
+    }
+    // push and insert below only use capacity reserved above
+    trDArrayMakeEmpty(regex->stateList);
+    trMutexLock(&arena->index->lock);
+    for (int i = 0; i < idCount; i++)
+    {
+        trDArrayPush(regex->stateList, trDArrayGetElement(arena->fillerList, i));
+    }
+    arena->index->reserved -= stateCount;
+    trDArrayInsertAll(arena->stateList, owned);
+    trMutexUnlock(&arena->index->lock);
+    for (int i = 0; i < idCount; i++)
+    {
+        if (used[i] == 1)
         {
-            result = tRegexCompareFuncRec(trDArrayGetElement(startingState, i), string, pos+1, length);
-            if (result == 1)
-            {
-                return result;
-            }
+            trDArraySetElement(regex->stateList, byId[i], i);
         }
-        return 0;
     }
-    return 0;
+    regex->shared = 1;
+    regex->onePass = tRegexIsOnePass(regex);
+
+    trDArrayDelete(owned);
+    trMemoryFree(predecessor);
+    trMemoryFree(targets);
+    trMemoryFree(order);
+    trMemoryFree(byId);
+    trMemoryFree(used);
+    trMemoryFree(shared);
+    trMemoryFree(mapped);
+    trMemoryFree(predecessorStart);
+    trMemoryFree(edgeStart);
+    trMemoryFree(pending);
+    return 1;
 }
 
 /**
-    Function to compare pattern of string with regex
-    @param regex : regex that will used
-    @param string : string to check is it match with regex
-    @return 1 if there's minimum 1 pattern match, 0 if no patter match
+    Work shared by compiling thread, every thread take next regex until none left
+    @attribute regexes : regex to be compiled
+    @attribute count : number of regex
+    @attribute next : index of next regex to be taken
+    @attribute failed : 1 if any regex failed to compile
+    @attribute arena : arena that compiled regex is moved into, NULL if not used
+    @attribute original : index of earlier regex with same code and flag, -1 if none (compiled once)
 */
-int tRegexComparePattern(TRegex regex, char *string)
+typedef struct TRCompileWork
 {
-    return tRegexCompareFuncRec(regex.startingState, string, 0, strlen(string));
-}
+    TRegex *regexes;
+    int count;
+    int next;
+    int failed;
+    TRegexArena *arena;
+    int *original;
+} TRCompileWork;
 
+/**
+    Function run by each compiling thread
+    @param argument : pointer to TRCompileWork
+    @return NULL
+*/
+void *trCompileWorker(void *argument)
+{
+    TRCompileWork *work = (TRCompileWork*)argument;
+    int i = __atomic_fetch_add(&work->next, 1, __ATOMIC_RELAXED);
+    while (i < work->count)
+    {
+        TRegex *regex = &work->regexes[i];
+        if (work->original != NULL && work->original[i] >= 0)
+        {
+            // copied from the earlier one after every thread finished
+        }
+        else if (tRegexCompile(regex) == 0)
+        {
+            __atomic_store_n(&work->failed, 1, __ATOMIC_RELAXED);
+        }
+        else if (work->arena != NULL && regex->shared == 0)
+        {
+            // regex not moved into arena still work, it only keep it's own state
+            trArenaIntern(work->arena, regex);
+        }
+        i = __atomic_fetch_add(&work->next, 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
 
 /**
-    Function to convert code of regex's notation to state node
-    @param code : code that will be converted
-    @param graphNode : dynamic array of node to store all state
+    Function to find regex with same code and flag as earlier regex, so it's compiled only once
+    @param regexes : array of regex
+    @param count : number of regex
+    @param original : array to store index of earlier same regex (-1 if none)
 */
-void convertCode(char *code, TRDArray *graphNode)
+void trCompileFindDuplicate(TRegex *regexes, int count, int *original)
 {
-    int position = 0;
-    int length = strlen(code);
-    int bracket = 0;
-    while(position < length)
+    int tableSize = 1;
+    while (tableSize <= count * 2)
     {
-        if (code[position] == '\\')
+        tableSize *= 2;
+    }
+    int *table = (int*)trMemoryAlloc(sizeof(int) * tableSize);
+    if (table == NULL)
+    {
+        // every regex is compiled by itself
+        for (int i = 0; i < count; i++)
         {
-            position += 1;
-            if (code[position] == 'w')
-            {
-                trDArrayPush(graphNode, trDArrayInit('w', LETTERS));
-            }
-            else if (code[position] == 'd')
-            {
-                trDArrayPush(graphNode, trDArrayInit('d', NUMBERS));
-            }
-            else
-            {
-                trDArrayPush(graphNode, trDArrayInit(code[position], NORMAL));
-            }
+            original[i] = -1;
         }
-        else if (code[position] == '(' || code[position] == ')' || code[position] == '*' || code[position] == '|' || code[position] == '+' || code[position] == '?')
+        return;
+    }
+    for (int i = 0; i < tableSize; i++)
+    {
+        table[i] = -1;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        original[i] = -1;
+        if (tRegexIsCompiled(&regexes[i]) == 1)
         {
-            trDArrayPush(graphNode, trDArrayInit(code[position], SYMBOL));
+            continue;
         }
-        else if (code[position] == '.')
+        unsigned int hash = regexes[i].flags;
+        for (int j = 0; regexes[i].code[j] != 0; j++)
         {
-            trDArrayPush(graphNode, trDArrayInit(code[position], ANYTHING));
+            hash = hash * 31 + (unsigned char)regexes[i].code[j];
+        }
+        unsigned int slot = (hash * 2654435761u) & (tableSize - 1);
+        while (table[slot] >= 0 && (regexes[table[slot]].flags != regexes[i].flags || strcmp(regexes[table[slot]].code, regexes[i].code) != 0))
+        {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (table[slot] < 0)
+        {
+            table[slot] = i;
         }
         else
         {
-            trDArrayPush(graphNode, trDArrayInit(code[position], NORMAL));
+            original[i] = table[slot];
         }
-
-        position++;
     }
+    trMemoryFree(table);
 }
 
 /**
-    Function to compile regex graph from regex string notation
-    @param regex : regex to be compiled
+    Function to compile many regex at once, regex is compiled by threadCount thread and each thread move
+    graph it compiled into arena where equal sub graph (like same suffix) is shared, regex with same code
+    and flag is compiled once and share the whole graph. Regex in arena match like normal regex but it's
+    state must not be changed (tRegexOptimizeWithProfile do nothing), profile of shared state is counted together
+    @param arena : arena that will own the state, NULL to only compile in parallel
+    @param regexes : array of regex to be compiled
+    @param count : number of regex
+    @param threadCount : number of thread used to compile (1 or less to compile in calling thread)
+    @return 1 if all regex compiled, 0 if any regex doesn't fit memory budget (other regex is still compiled)
 */
-void tRegexCompile(TRegex *regex)
+int tRegexCompileMany(TRegexArena *arena, TRegex *regexes, int count, int threadCount)
 {
-    if (tRegexIsCompiled(regex) == 0)
+    TRCompileWork work;
+    work.regexes = regexes;
+    work.count = count;
+    work.next = 0;
+    work.failed = 0;
+    work.arena = arena != NULL && arena->index != NULL ? arena : NULL;
+    work.original = NULL;
+    if (work.arena != NULL)
     {
-        char appendedCode[257] = "";
-        strcpy(appendedCode, "(");
-        strcat(appendedCode, regex->code);
-        strcat(appendedCode, ")");
-
-        TRDArray *allGraphNode = trDArrayInit(0, EMPTY);
-        convertCode(appendedCode, allGraphNode);
+        // without it every regex is compiled by itself
+        work.original = (int*)trMemoryAlloc(sizeof(int) * count + 1);
+    }
+    if (work.original != NULL)
+    {
+        trCompileFindDuplicate(regexes, count, work.original);
+    }
 
-//        TRDArray *currentState = trDArrayInit(0);
-//        TRDArray *nextState = trDArrayInit(0);
-//        TRDArray *endState = trDArrayInit(0);
-//        trDArrayPush(currentState, regex->startingState);
-//        int start = 0;
-//        dummy2(currentState, nextState, endState, allGraphNode, &start);
+#if !defined(_WIN32)
+    pthread_t *threads = (pthread_t*)trMemoryAlloc(sizeof(pthread_t) * (threadCount > 1 ? threadCount : 1));
+    int started = 0;
+    while (threads != NULL && started < threadCount - 1 && pthread_create(&threads[started], NULL, trCompileWorker, &work) == 0)
+    {
+        started += 1;
+    }
+    trCompileWorker(&work);
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    trMemoryFree(threads);
+#else
+    trCompileWorker(&work);
+#endif
 
-        TRDArray *nextState = trDArrayInit(0, EMPTY);
-        TRDArray *endState = trDArrayInit(0, EMPTY);
-//        trDArrayPush(endState, regex->startingState);
-        int start = 0;
-        tRegexCompileFuncRec(nextState, endState, allGraphNode, &start);
-        for (int i = 0; i < trDArrayGetSize(nextState); i++)
+    for (int i = 0; work.original != NULL && i < count; i++)
+    {
+        TRegex *source = work.original[i] >= 0 ? &regexes[work.original[i]] : NULL;
+        if (source != NULL && tRegexIsCompiled(source) == 1 && source->shared == 0)
         {
-            trDArrayPush(regex->startingState, trDArrayGetElement(nextState, i));
+            // earlier one couldn't be moved into arena, so it's state couldn't be shared
+            work.failed |= tRegexCompile(&regexes[i]) == 0;
         }
-
-        TRDArray *endStateNode = trDArrayInit(0, END);
-        for (int i = 0; i < trDArrayGetSize(endState); i++)
+        else if (source != NULL && tRegexIsCompiled(source) == 1)
         {
-            trDArrayPush(trDArrayGetElement(endState, i), endStateNode);
+            TRDArray *stateList = trDArrayInit(0, EMPTY);
+            if (stateList == NULL || trDArrayInsertAll(stateList, source->stateList) == 0)
+            {
+                trDArrayDelete(stateList);
+                work.failed = 1;
+                continue;
+            }
+            trDArrayDelete(regexes[i].startingState);
+            regexes[i] = *source;
+            regexes[i].stateList = stateList;
         }
+    }
+    trMemoryFree(work.original);
+    return work.failed == 0;
+}
 
+/**
+    Function to count memory used by compiled regex
+    @param regex : regex to be counted
+    @return bytes used by graph and state list of regex
+*/
+size_t tRegexMemoryUsage(const TRegex *regex)
+{
+    if (regex->stateList == NULL)
+    {
+        return regex->startingState == NULL ? 0 : trDArrayMemoryUsage(regex->startingState);
+    }
 
-        //int pos = 0;
-        //tRegexCompileFuncRec(regex->startingState, appendedCode, &pos, strlen(appendedCode));
+    size_t usage = trDArrayMemoryUsage(regex->stateList);
+    for (int i = 0; i < trDArrayGetSize(regex->stateList); i++)
+    {
+        usage += trDArrayMemoryUsage(trDArrayGetElement(regex->stateList, i));
+    }
+    return usage;
+}
 
-        trDArrayDelete(allGraphNode);
-        regex->compiled = 1;
+#ifndef TREGEX_NO_MAIN
+/**
+    Allocator for testing that fail after some allocation
+*/
+int testAllocLeft = -1;
+void *testFailingAlloc(size_t size)
+{
+    if (testAllocLeft == 0)
+    {
+        return NULL;
+    }
+    if (testAllocLeft > 0)
+    {
+        testAllocLeft -= 1;
     }
+    return malloc(size);
 }
 
 int main()
@@ -998,6 +5210,382 @@ int main()
     tRegexCompile(&regex);
     printf("%s\n", tRegexComparePattern(regex, "hans.sean22@mhsits.ac.id") == 1 ? "True" : "False");
 
+    tRegexSetProfiling(1);
+    tRegexSetCode(&regex, "a(h|l)*k");
+    tRegexCompile(&regex);
+    tRegexComparePattern(regex, "ahlk");
+    tRegexSetProfiling(0);
+    FILE *dot = tmpfile();
+    tRegexDumpDot(&regex, dot);
+    int profiled = regex.startingState->hits == 1;
+    int edgeCount = 0;
+    char expectedEdge[64] = "";
+    for (int i = 0; i < trDArrayGetSize(regex.stateList); i++)
+    {
+        TRDArray *state = trDArrayGetElement(regex.stateList, i);
+        edgeCount += trDArrayGetSize(state);
+        // 'h' is tried before 'l' at every loop turn, so it's tried at "hlk" and 'l' at "lk"
+        if (trDArrayGetType(state) == NORMAL && strchr("ahlk", trDArrayGetData(state)) != NULL)
+        {
+            long expectedHits = trDArrayGetData(state) == 'h' ? 3 : trDArrayGetData(state) == 'l' ? 2 : 1;
+            if (state->hits != expectedHits)
+            {
+                profiled = 0;
+            }
+        }
+        if (trDArrayGetType(state) == OPEN && trDArrayGetGroup(state) == 1)
+        {
+            sprintf(expectedEdge, "n%d -> n%d [label=\"3\"", state->id, trDArrayGetElement(state, 0)->id);
+        }
+    }
+    char dotText[4096] = "";
+    rewind(dot);
+    dotText[fread(dotText, 1, sizeof(dotText) - 1, dot)] = '\0';
+    int edgeLines = 0;
+    for (char *line = strstr(dotText, " -> "); line != NULL; line = strstr(line + 1, " -> "))
+    {
+        edgeLines += 1;
+    }
+    printf("%s\n", profiled == 1 && edgeLines == edgeCount && strstr(dotText, expectedEdge) != NULL ? "True" : "False");
+    fclose(dot);
+
+    // long string is profiled by state set, no recursion per character
+    int profiledLength = 2 * 1024 * 1024;
+    char *profiledString = (char*)malloc(profiledLength);
+    memset(profiledString, 'a', profiledLength - 1);
+    profiledString[profiledLength - 1] = 'b';
+    tRegexSetCode(&regex, "a*b");
+    tRegexCompile(&regex);
+    tRegexSetProfiling(1);
+    int profiledLong = tRegexMatch(&regex, profiledString, profiledLength) == MATCH;
+    tRegexSetProfiling(0);
+    long loopHits = 0;
+    for (int i = 0; i < trDArrayGetSize(regex.stateList); i++)
+    {
+        if (trDArrayGetType(trDArrayGetElement(regex.stateList, i)) == NORMAL && trDArrayGetData(trDArrayGetElement(regex.stateList, i)) == 'a')
+        {
+            loopHits = trDArrayGetElement(regex.stateList, i)->hits;
+        }
+    }
+    free(profiledString);
+    printf("%s\n", profiledLong == 1 && loopHits >= profiledLength - 1 ? "True" : "False");
+
+    size_t usage = tRegexMemoryUsage(&regex);
+    printf("%s\n", usage > 0 && usage <= tRegexMemoryTotal() ? "True" : "False");
+    tRegexSetMemoryBudget(tRegexMemoryTotal() + 64);
+    tRegexSetCode(&regex, "\\w+(\\w|\\.|\\d)*@\\w+\\.(\\w+\\.)*\\w+");
+    printf("%s\n", tRegexCompile(&regex) == 0 && tRegexComparePattern(regex, "a@b.c") == 0 ? "True" : "False");
+    tRegexSetMemoryBudget(0);
+
+    tRegexSetAllocator(testFailingAlloc, free);
+    int allocFailedCleanly = 1;
+    int allocCompiled = 0;
+    for (int i = 0; i < 400 && allocCompiled == 0; i++)
+    {
+        tRegexSetCode(&regex, "\\w+(\\w|\\.|\\d)*@\\w+\\.(\\w+\\.)*\\w+");
+        size_t before = tRegexMemoryTotal();
+        testAllocLeft = i;
+        allocCompiled = tRegexCompile(&regex);
+        testAllocLeft = -1;
+        if (allocCompiled == 0 && (regex.stateList != NULL || tRegexMemoryTotal() != before || tRegexComparePattern(regex, "a@b.c") != 0))
+        {
+            allocFailedCleanly = 0;
+        }
+    }
+    tRegexSetAllocator(malloc, free);
+    printf("%s\n", allocFailedCleanly == 1 && allocCompiled == 1 && tRegexComparePattern(regex, "hans.sean22@mhsits.ac.id") == 1 ? "True" : "False");
+
+    // allocation while matching could fail too, result is NO_MEMORY (or correct) and nothing leak
+    tRegexSetCode(&regex, "(\\w+)@(\\w+)\\.com");
+    tRegexCompile(&regex);
+    tRegexSetAllocator(testFailingAlloc, free);
+    int matchFailedCleanly = 1;
+    for (int i = 0; i < 12; i++)
+    {
+        int matchGroups[6];
+        char replaced[64];
+        TRSlice matchSpans[4];
+        size_t before = tRegexMemoryTotal();
+        testAllocLeft = i;
+        int matched = tRegexMatch(&regex, "hans@gmail.com", 14);
+        testAllocLeft = i;
+        int grouped = tRegexMatchGroups(&regex, "hans@gmail.com", 14, matchGroups);
+        testAllocLeft = i;
+        size_t replacedLength = tRegexReplaceAll(&regex, "to hans@gmail.com!", 18, "<$1>", replaced, sizeof(replaced));
+        testAllocLeft = i;
+        int spanCount = tRegexSplit(&regex, "a b@c.com d", 11, matchSpans, 4);
+        testAllocLeft = -1;
+        if ((matched != MATCH && matched != NO_MEMORY) || (grouped != MATCH && grouped != NO_MEMORY)
+            || (replacedLength != SIZE_MAX && strcmp(replaced, "to <hans>!") != 0) || (spanCount != -1 && spanCount != 2)
+            || tRegexMemoryTotal() != before)
+        {
+            matchFailedCleanly = 0;
+        }
+    }
+    tRegexSetAllocator(malloc, free);
+    tRegexSetMemoryBudget(tRegexMemoryTotal() + 16);
+    char replacedOverBudget[64];
+    size_t replacedLengthOverBudget = tRegexReplaceAll(&regex, "hans@gmail.com", 14, "$2", replacedOverBudget, sizeof(replacedOverBudget));
+    int patternOverBudget = tRegexComparePattern(regex, "hans@gmail.com");
+    tRegexSetMemoryBudget(0);
+    printf("%s\n", matchFailedCleanly == 1 && replacedLengthOverBudget == SIZE_MAX && replacedOverBudget[0] == 0 && patternOverBudget == 0 && tRegexComparePattern(regex, "hans@gmail.com") == 1 ? "True" : "False");
+
+    tRegexSetCode(&regex, "(a|aa)*b");
+    tRegexCompile(&regex);
+    printf("%s\n", tRegexCompareBudget(&regex, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaac", 41, 1000, 0) == TIMEOUT ? "True" : "False");
+    long long started = trBudgetNow();
+    int timedOut = tRegexCompareBudget(&regex, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaac", 41, -1, 0.01) == TIMEOUT;
+    printf("%s\n", timedOut == 1 && trBudgetNow() - started < 1000000000LL ? "True" : "False");
+    printf("%s\n", tRegexCompareAuto(&regex, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaac", 41, 1000) == NO_MATCH ? "True" : "False");
+
+    // loop of empty state is cut and too deep recursion is finished by state set, so C stack never run out
+    tRegexSetCode(&regex, "(a*)*b");
+    tRegexCompile(&regex);
+    int emptyLoopCut = tRegexCompareBudget(&regex, "aac", 3, 1000000, 0) == NO_MATCH && tRegexCompareBudget(&regex, "aac", 3, -1, 0.05) == NO_MATCH
+                       && tRegexCompareAuto(&regex, "aac", 3, 100000000) == NO_MATCH && tRegexCompareBudget(&regex, "aab", 3, -1, 0) == MATCH;
+    char deepString[20001];
+    memset(deepString, 'a', 20000);
+    deepString[20000] = 'b';
+    tRegexSetCode(&regex, "(a|c)*b");
+    tRegexCompile(&regex);
+    printf("%s\n", emptyLoopCut == 1 && tRegexCompareBudget(&regex, deepString, 20001, -1, 0) == MATCH && tRegexCompareAuto(&regex, deepString, 20000, -1) == NO_MATCH ? "True" : "False");
+    printf("%s\n", tRegexCompareStateSet(&regex, "aaaab", 5) == MATCH ? "True" : "False");
+    printf("%s\n", tRegexCompareBitState(&regex, "aaaab", 5) == MATCH ? "True" : "False");
+
+    char *longString = (char*)malloc(1000002);
+    memset(longString, 'a', 1000000);
+    strcpy(longString + 1000000, "b");
+    printf("%s\n", tRegexComparePattern(regex, longString) == 1 ? "True" : "False");
+    free(longString);
+
+    int groups[8];
+    tRegexSetCode(&regex, "(\\w+)@(\\w+)\\.com");
+    tRegexCompile(&regex);
+    tRegexMatchGroups(&regex, "hans_sean@gmail.com", 19, groups);
+    printf("%s\n", regex.onePass == 1 && groups[2] == 0 && groups[3] == 9 && groups[4] == 10 && groups[5] == 15 ? "True" : "False");
+
+    // starred first character must still lead to the rest, group matching empty at the end is set
+    tRegexSetCode(&regex, "(.*(A?)|b)");
+    tRegexCompile(&regex);
+    tRegexMatchGroups(&regex, "xy", 2, groups);
+    printf("%s\n", groups[2] == 0 && groups[3] == 2 && groups[4] == 2 && groups[5] == 2 ? "True" : "False");
+    tRegexSetCode(&regex, "x*A");
+    tRegexCompile(&regex);
+    printf("%s\n", tRegexComparePattern(regex, "xxA") == 1 && tRegexComparePattern(regex, "xx") == 0 ? "True" : "False");
+
+    tRegexSetCode(&regex, "ab*cd*efg");
+    tRegexCompile(&regex);
+    printf("%s\n", regex.minLength == 5 && regex.maxLength == -1 && regex.literal == 0 ? "True" : "False");
+    printf("%s\n", tRegexQuickCheck(&regex, "aefg", 4) == NO_MATCH && tRegexQuickCheck(&regex, "bcefg", 5) == NO_MATCH ? "True" : "False");
+
+    tRegexSetCode(&regex, "(hello)");
+    tRegexCompile(&regex);
+    printf("%s\n", regex.literal == 1 && tRegexComparePattern(regex, "hello") == 1 && tRegexComparePattern(regex, "hellp") == 0 ? "True" : "False");
+
+    tRegexSetCode(&regex, "employ(er|ee|ment|ing|able|)");
+    tRegexCompile(&regex);
+    printf("%s\n", regex.minLength == 6 && regex.maxLength == 10 && trByteSetHas(regex.lastBytes, 'y') == 1 ? "True" : "False");
+
+    tRegexSetCode(&regex, "(test|testing|tested|tester|toast)");
+    tRegexCompile(&regex);
+    // without factoring every alternative has it's own 'e' (6 state), shared "test" and "teste" leave 2
+    int factoredE = 0;
+    for (int i = 0; i < trDArrayGetSize(regex.stateList); i++)
+    {
+        TRDArray *state = trDArrayGetElement(regex.stateList, i);
+        factoredE += trDArrayGetType(state) == NORMAL && trDArrayGetData(state) == 'e';
+    }
+    // each alternative in it's own group start with different OPEN state, so nothing is factored
+    TRegex unfactored = tRegexInit();
+    tRegexSetCode(&unfactored, "((test)|(testing)|(tested)|(tester)|(toast))");
+    tRegexCompile(&unfactored);
+    char *factorWords[] = {"test", "testing", "tested", "tester", "toast", "tes", "testin", "testes", "testers", "toas", "tost", ""};
+    int factorSame = 1;
+    for (int i = 0; i < 12; i++)
+    {
+        int expected = tRegexComparePattern(unfactored, factorWords[i]);
+        if (expected != (i < 5) || tRegexComparePattern(regex, factorWords[i]) != expected)
+        {
+            factorSame = 0;
+        }
+    }
+    trDArrayDeleteAll(&unfactored.startingState);
+    trDArrayDelete(unfactored.stateList);
+    printf("%s\n", factoredE == 2 && factorSame == 1 ? "True" : "False");
+
+    // \w between the two 'b' could take 'b' too, so they're not merged and \w\w\w is still tried before b
+    char factorReplaced[16];
+    tRegexSetCode(&regex, "bx|\\w\\w\\w|b");
+    tRegexCompile(&regex);
+    tRegexReplaceAll(&regex, "bcd", 3, "-", factorReplaced, sizeof(factorReplaced));
+    tRegexSetCode(&regex, "(bx|\\w\\w|b)(\\w*)");
+    tRegexCompile(&regex);
+    tRegexMatchGroups(&regex, "bcd", 3, groups);
+    printf("%s\n", strcmp(factorReplaced, "-") == 0 && groups[2] == 0 && groups[3] == 2 && groups[4] == 2 && groups[5] == 3 ? "True" : "False");
+
+    tRegexSetCode(&regex, "employ(er|ee|ment|ing|able|)");
+    tRegexCompile(&regex);
+    TRBudget before = trBudgetInit(-1, 0);
+    tRegexCompareFuncRec(regex.startingState, "employable", 0, 10, &before);
+    tRegexSetProfiling(1);
+    tRegexComparePattern(regex, "employable");
+    tRegexComparePattern(regex, "employable");
+    tRegexComparePattern(regex, "employee");
+    tRegexSetProfiling(0);
+    char *employWords[] = {"employ", "employer", "employee", "employment", "employing", "employable", "employe", "employs", "emplo", "employablee"};
+    int employBefore[10];
+    int employGroups[4];
+    for (int i = 0; i < 10; i++)
+    {
+        employBefore[i] = tRegexMatchGroups(&regex, employWords[i], strlen(employWords[i]), employGroups) * 100 + employGroups[2] * 10 + employGroups[3];
+    }
+    TRegex employCopy = regex;
+    tRegexOptimizeWithProfile(&regex);
+    TRBudget after = trBudgetInit(-1, 0);
+    int employSame = 1;
+    for (int i = 0; i < 10; i++)
+    {
+        int result = tRegexMatchGroups(&regex, employWords[i], strlen(employWords[i]), employGroups) * 100 + employGroups[2] * 10 + employGroups[3];
+        if (result != employBefore[i] || tRegexComparePattern(regex, employWords[i]) != employBefore[i] / 100 || tRegexComparePattern(employCopy, employWords[i]) != employBefore[i] / 100)
+        {
+            employSame = 0;
+        }
+    }
+    printf("%s\n", tRegexCompareFuncRec(regex.startingState, "employable", 0, 10, &after) == MATCH && after.spent < before.spent && employSame == 1 ? "True" : "False");
+
+    // \w\w lead to match more often but 'a' could also be taken by \w, so 'a' must still be tried first
+    char optimizedReplaced[16];
+    tRegexSetCode(&regex, "(a|\\w\\w)(\\w*)");
+    tRegexCompile(&regex);
+    tRegexSetProfiling(1);
+    tRegexComparePattern(regex, "zzz");
+    tRegexSetProfiling(0);
+    tRegexOptimizeWithProfile(&regex);
+    tRegexMatchGroups(&regex, "ab", 2, groups);
+    tRegexReplaceAll(&regex, "ab", 2, "[$1]", optimizedReplaced, sizeof(optimizedReplaced));
+    printf("%s\n", groups[2] == 0 && groups[3] == 1 && strcmp(optimizedReplaced, "[a]") == 0 ? "True" : "False");
+
+    char longEmail[1100];
+    memset(longEmail, 'x', 1000);
+    strcpy(longEmail + 1000, "@gmail.com");
+    tRegexSetCode(&regex, "\\w+@\\w+\\.com");
+    tRegexCompile(&regex);
+    printf("%s\n", tRegexCompareBudget(&regex, longEmail, 1010, 100, 0) == MATCH && tRegexCompareBitState(&regex, longEmail, 1010) == MATCH ? "True" : "False");
+
+    // next state is only tried where it's first character is, and state set skip the run too
+    int runLength = 100000;
+    char *longRun = (char*)malloc(runLength + 10);
+    memset(longRun, 'x', runLength);
+    memcpy(longRun + runLength, "@gmail.com", 10);
+    TRSlice runSlices[2] = {{longRun, 5000}, {longRun + 5000, runLength + 5 - 5000}};
+    printf("%s\n", tRegexCompareBudget(&regex, longRun, runLength, 100, 0) == NO_MATCH && tRegexCompareBitState(&regex, longRun, runLength) == NO_MATCH && tRegexCompareStateSet(&regex, longRun, runLength) == NO_MATCH ? "True" : "False");
+    printf("%s\n", tRegexCompareStateSet(&regex, longRun, runLength + 10) == MATCH && trStateSetRun(&regex, runSlices, 2) == NO_MATCH && tRegexCompareStateSet(&regex, longRun + 1, runLength + 8) == NO_MATCH ? "True" : "False");
+    free(longRun);
+
+    char record[] = "id=42;mail=hans_sean@gmail.com;name=hans";
+    TRSlice packet[3] = {{"hans_", 5}, {"sean@gm", 7}, {"ail.com", 7}};
+    printf("%s\n", tRegexMatch(&regex, record + 11, 19) == MATCH && tRegexMatch(&regex, record, 19) == NO_MATCH && tRegexMatchSlices(&regex, packet, 3) == MATCH ? "True" : "False");
+
+    // nothing is read when length doesn't fit in int
+    size_t hugeLength = (size_t)INT_MAX + 1;
+    TRSlice hugeSpans[2];
+    char hugeOutput[8] = "x";
+    printf("%s\n", tRegexMatch(&regex, record, hugeLength) == TOO_LONG && tRegexMatchGroups(&regex, record, hugeLength, groups) == TOO_LONG
+                  && tRegexCompareBudget(&regex, record, hugeLength, 100, 0) == TOO_LONG && tRegexCompareAuto(&regex, record, hugeLength, 100) == TOO_LONG
+                  && tRegexReplaceAll(&regex, record, hugeLength, "", hugeOutput, 8) == SIZE_MAX && hugeOutput[0] == 0
+                  && tRegexSplit(&regex, record, hugeLength, hugeSpans, 2) == -1 ? "True" : "False");
+
+    tRegexSetCode(&regex, "a.b");
+    tRegexCompile(&regex);
+    printf("%s\n", tRegexMatch(&regex, "a\0b", 3) == MATCH ? "True" : "False");
+
+    tRegexSetCode(&regex, "h.t");
+    tRegexCompile(&regex);
+    printf("%s\n", tRegexComparePattern(regex, "h\xC3\xA9t") == 0 ? "True" : "False");
+    tRegexSetFlags(&regex, FLAG_UTF8);
+    tRegexCompile(&regex);
+    printf("%s\n", tRegexComparePattern(regex, "h\xC3\xA9t") == 1 && tRegexComparePattern(regex, "h\xE2\x82\xACt") == 1 && tRegexComparePattern(regex, "h\xC3t") == 0 && tRegexComparePattern(regex, "hit") == 1 ? "True" : "False");
+
+    tRegexSetCode(&regex, "caf\xC3\xA9+");
+    tRegexCompile(&regex);
+    printf("%s\n", tRegexComparePattern(regex, "caf\xC3\xA9\xC3\xA9") == 1 && tRegexComparePattern(regex, "caf\xC3\xA9\xA9") == 0 ? "True" : "False");
+
+    tRegexSetCode(&regex, "h.t");
+    tRegexCompile(&regex);
+    printf("%s\n", tRegexCompareBudget(&regex, "h\xE2\x82\xACt", 5, 1000, 1.0) == MATCH && tRegexCompareBudget(&regex, "h\xC3t", 3, 1000, 1.0) == NO_MATCH ? "True" : "False");
+
+    tRegexSetFlags(&regex, FLAG_IGNORE_CASE);
+    tRegexSetCode(&regex, "Hello w*orld!");
+    tRegexCompile(&regex);
+    printf("%s\n", tRegexComparePattern(regex, "hELLo WwWORLD!") == 1 && tRegexComparePattern(regex, "hello@world!") == 0 && tRegexCompareBudget(&regex, "HELLO WORLD!", 12, 1000, 1.0) == MATCH ? "True" : "False");
+    tRegexSetFlags(&regex, 0);
+
+    TRegexArena arena = tRegexArenaInit();
+    TRegex rules[3] = {tRegexInitCode("\\w+@\\w+\\.com"), tRegexInitCode("(\\w+\\.)*\\w+@mail\\.com"), tRegexInitCode("\\w+@\\w+\\.com")};
+    tRegexCompileMany(&arena, rules, 3, 2);
+    printf("%s\n", rules[0].startingState == rules[2].startingState && trDArrayGetSize(arena.stateList) < trDArrayGetSize(rules[0].stateList) + trDArrayGetSize(rules[1].stateList) && tRegexComparePattern(rules[1], "hans.sean@mail.com") == 1 && tRegexComparePattern(rules[1], "hans@gmail.com") == 0 && tRegexComparePattern(rules[2], "hans@gmail.com") == 1 ? "True" : "False");
+    int arenaClean = 1;
+    for (int i = 0; i < trDArrayGetSize(arena.stateList); i++)
+    {
+        TRDArray *state = trDArrayGetElement(arena.stateList, i);
+        for (int j = 0; j < trDArrayGetSize(state); j++)
+        {
+            for (int k = 0; k < j; k++)
+            {
+                arenaClean = arenaClean && trDArrayGetElement(state, j) != trDArrayGetElement(state, k);
+            }
+        }
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        arenaClean = arenaClean && rules[i].onePass == tRegexIsOnePass(&rules[i]);
+    }
+    printf("%s\n", arenaClean == 1 ? "True" : "False");
+    for (int i = 0; i < 3; i++)
+    {
+        tRegexSetCode(&rules[i], "");
+    }
+    tRegexArenaDelete(&arena);
+
+    char replaced[64];
+    tRegexSetCode(&regex, "(\\w+)@(\\w+)\\.com");
+    tRegexCompile(&regex);
+    size_t replacedLength = tRegexReplaceAll(&regex, "to hans@gmail.com, sean@mail.com.", 33, "$2:$1", replaced, sizeof(replaced));
+    printf("%s\n", strcmp(replaced, "to gmail:hans, mail:sean.") == 0 && replacedLength == 25 ? "True" : "False");
+
+    TRSlice spans[4];
+    tRegexSetCode(&regex, ", *");
+    tRegexCompile(&regex);
+    int spanCount = tRegexSplit(&regex, "ab,  cd,ef", 10, spans, 4);
+    printf("%s\n", spanCount == 3 && spans[1].length == 2 && memcmp(spans[1].data, "cd", 2) == 0 && spans[2].length == 2 ? "True" : "False");
+
+    // thread that could never match doesn't make every search read the rest of input again
+    int linearLength = 100000;
+    char *linearInput = (char*)malloc(linearLength);
+    char *linearOutput = (char*)malloc(linearLength + 1);
+    memset(linearInput, 'a', linearLength);
+    tRegexSetCode(&regex, "\\w*x|a");
+    tRegexCompile(&regex);
+    long long linearStarted = trBudgetNow();
+    size_t linearWritten = tRegexReplaceAll(&regex, linearInput, linearLength, "-", linearOutput, linearLength + 1);
+    int linearSpans = tRegexSplit(&regex, linearInput, linearLength, spans, 4);
+    int linearFast = trBudgetNow() - linearStarted < 2000000000LL;
+    printf("%s\n", linearWritten == (size_t)linearLength && linearOutput[0] == '-' && linearOutput[linearLength - 1] == '-' && linearSpans == linearLength + 1 && linearFast == 1 ? "True" : "False");
+    free(linearOutput);
+    free(linearInput);
+
+    // regex not compiled (or refused by memory budget) never match
+    TRegex notCompiled = tRegexInitCode("a");
+    spanCount = tRegexSplit(&notCompiled, "bab", 3, spans, 4);
+    replacedLength = tRegexReplaceAll(&notCompiled, "bab", 3, "x", replaced, sizeof(replaced));
+    printf("%s\n", spanCount == 1 && spans[0].length == 3 && replacedLength == 3 && strcmp(replaced, "bab") == 0 ? "True" : "False");
+    trDArrayDelete(notCompiled.startingState);
+
+    tRegexSetCode(&regex, "(\\w+\\.)*(\\w+)");
+    tRegexCompile(&regex);
+    tRegexMatchGroups(&regex, "mhsits.ac.id", 12, groups);
+    printf("%s\n", regex.onePass == 0 && groups[2] == 7 && groups[3] == 10 && groups[4] == 10 && groups[5] == 12 ? "True" : "False");
+
 //    tRegexSetCode(&regex, "\\w+(\\w|\\.)*@\\w+\\.com");
 //    tRegexCompile(&regex);
 //    printf("%s\n", tRegexComparePattern(regex, "hans.sean@gmail.com") == 1 ? "True" : "False");
@@ -1009,3 +5597,4 @@ int main()
 //    printf("%s\n", p == NULL ? "NULL" : "Tidak Otomatis");
     return 0;
 }
+#endif
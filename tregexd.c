@@ -0,0 +1,854 @@
+/**
+    tregexd, local matching daemon, compile rule set once and serve match request of every process in
+    the same host through Unix domain socket
+
+    tregexd serve <socket path> <rule file> [thread]
+    tregexd client <socket path> <rule> <string>
+    tregexd bench <socket path> <rule> <string> [connection] [request per connection] [pipeline]
+
+    Rule file contains one regex notation per line, rule index is it's line (empty line skipped).
+    Every request and response is one frame, request id is copied to response so client could send many
+    request without waiting (response could come in different order)
+*/
+#define _GNU_SOURCE
+#define TREGEX_NO_MAIN
+#include "tregex.c"
+
+#ifdef __linux__
+#include "errno.h"
+#include "signal.h"
+#include "stdint.h"
+#include "unistd.h"
+#include "sys/epoll.h"
+#include "sys/socket.h"
+#include "sys/time.h"
+#include "sys/un.h"
+
+enum {TRD_ANY_RULE = -1, TRD_BAD_RULE = -2};
+enum {TRD_MAX_LENGTH = 1 << 20, TRD_MAX_EVENTS = 64, TRD_READ_SIZE = 64 * 1024};
+// bytes read from one connection in one wake up, rest is read in next wake up so other connection get their turn
+enum {TRD_READ_BUDGET = 4 * TRD_READ_SIZE};
+// input and output kept by one connection, client that send bigger request or never read response is closed
+enum {TRD_MAX_BUFFERED = 2 * TRD_MAX_LENGTH};
+
+/**
+    Header of request frame, followed by length byte of string
+    @attribute length : length of string
+    @attribute id : id chosen by client, copied to response
+    @attribute rule : index of rule to be matched, TRD_ANY_RULE to find first rule that match
+*/
+typedef struct TRRequestHeader
+{
+    uint32_t length;
+    uint32_t id;
+    int32_t rule;
+} TRRequestHeader;
+
+/**
+    Response frame
+    @attribute id : id of request
+    @attribute result : MATCH or NO_MATCH, index of first matched rule (-1 if none) for TRD_ANY_RULE,
+                        TRD_BAD_RULE if rule doesn't exist
+*/
+typedef struct TRResponse
+{
+    uint32_t id;
+    int32_t result;
+} TRResponse;
+
+/**
+    Buffer growing when needed
+    @attribute data : content of buffer
+    @attribute size : bytes used
+    @attribute capacity : bytes allocated
+*/
+typedef struct TRBuffer
+{
+    char *data;
+    size_t size;
+    size_t capacity;
+} TRBuffer;
+
+/**
+    Connection of one client
+    @attribute fd : socket
+    @attribute input : received bytes, request in batch point to it until batch finished
+    @attribute parsed : bytes of input already taken as request
+    @attribute output : response not sent yet
+    @attribute closed : 1 if client closed or sent broken frame, connection freed after batch
+    @attribute writing : 1 if waiting for socket to be writable
+    @attribute touched : 1 if already in list of connection touched by current batch
+*/
+typedef struct TRConnection
+{
+    int fd;
+    TRBuffer input;
+    size_t parsed;
+    TRBuffer output;
+    int closed;
+    int writing;
+    int touched;
+} TRConnection;
+
+/**
+    Request waiting in batch
+    @attribute connection : connection that send it
+    @attribute header : header of request
+    @attribute offset : position of string in input of connection
+    @attribute result : result of matching
+*/
+typedef struct TRPending
+{
+    TRConnection *connection;
+    TRRequestHeader header;
+    size_t offset;
+    int result;
+} TRPending;
+
+/**
+    State of daemon
+    @attribute rules : compiled rule
+    @attribute ruleCount : number of rule
+    @attribute arena : arena owning state of every rule
+    @attribute epoll : epoll instance
+    @attribute listener : listening socket
+    @attribute batch : request received in one wake up of event loop
+    @attribute batchSize : number of request in batch
+    @attribute batchCapacity : capacity of batch
+    @attribute touched : connection that received or need to send something in current batch
+    @attribute touchedSize : number of touched connection
+    @attribute touchedCapacity : capacity of touched
+*/
+typedef struct TRServer
+{
+    TRegex *rules;
+    int ruleCount;
+    TRegexArena arena;
+    int epoll;
+    int listener;
+    TRPending *batch;
+    int batchSize;
+    int batchCapacity;
+    TRConnection **touched;
+    int touchedSize;
+    int touchedCapacity;
+} TRServer;
+
+volatile sig_atomic_t trdRunning = 1;
+
+/**
+    Function to stop event loop when signal received
+    @param signal : received signal
+*/
+void trdStop(int signal)
+{
+    (void)signal;
+    trdRunning = 0;
+}
+
+/**
+    Function to get current time
+    @return seconds since epoch
+*/
+double trdNow()
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return now.tv_sec + now.tv_usec / 1e6;
+}
+
+/**
+    Function to make sure buffer could hold more bytes
+    @param buffer : buffer to be grown
+    @param more : bytes that will be added
+    @return 1 if success, 0 if allocation failed
+*/
+int trBufferReserve(TRBuffer *buffer, size_t more)
+{
+    if (buffer->size + more <= buffer->capacity)
+    {
+        return 1;
+    }
+
+    size_t capacity = buffer->capacity == 0 ? 4096 : buffer->capacity;
+    while (capacity < buffer->size + more)
+    {
+        capacity *= 2;
+    }
+    char *data = (char*)realloc(buffer->data, capacity);
+    if (data == NULL)
+    {
+        return 0;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return 1;
+}
+
+/**
+    Function to add bytes to end of buffer
+    @param buffer : buffer to be added
+    @param data : bytes to be added
+    @param size : number of bytes
+    @return 1 if success, 0 if allocation failed
+*/
+int trBufferAppend(TRBuffer *buffer, const void *data, size_t size)
+{
+    if (trBufferReserve(buffer, size) == 0)
+    {
+        return 0;
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+    return 1;
+}
+
+/**
+    Function to remove bytes from start of buffer
+    @param buffer : buffer to be consumed
+    @param size : number of bytes removed
+*/
+void trBufferConsume(TRBuffer *buffer, size_t size)
+{
+    if (size > 0)
+    {
+        memmove(buffer->data, buffer->data + size, buffer->size - size);
+        buffer->size -= size;
+    }
+}
+
+/**
+    Function to read every rule from file and compile them together
+    @param server : server that will own the rule
+    @param path : path of rule file
+    @param threadCount : number of thread used to compile
+    @return 1 if success, 0 if file couldn't be read or rule couldn't be compiled
+*/
+int trServerLoadRules(TRServer *server, const char *path, int threadCount)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        perror(path);
+        return 0;
+    }
+
+    char line[1024];
+    int capacity = 16;
+    server->rules = (TRegex*)malloc(sizeof(TRegex) * capacity);
+    server->ruleCount = 0;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == 0)
+        {
+            continue;
+        }
+        if (strlen(line) >= sizeof(server->rules[0].code))
+        {
+            fprintf(stderr, "%s: rule %d is too long\n", path, server->ruleCount);
+            fclose(file);
+            return 0;
+        }
+        if (server->ruleCount == capacity)
+        {
+            capacity *= 2;
+            server->rules = (TRegex*)realloc(server->rules, sizeof(TRegex) * capacity);
+        }
+        server->rules[server->ruleCount] = tRegexInitCode(line);
+        server->ruleCount += 1;
+    }
+    fclose(file);
+
+    server->arena = tRegexArenaInit();
+    if (tRegexCompileMany(&server->arena, server->rules, server->ruleCount, threadCount) == 0)
+    {
+        fprintf(stderr, "%s: rule doesn't fit memory budget\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+    Function to open listening socket
+    @param path : path of socket
+    @return socket, -1 if failed
+*/
+int trdListen(const char *path)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "%s: socket path too long\n", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    unlink(path);
+    if (listener < 0 || bind(listener, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(listener, 128) < 0)
+    {
+        perror(path);
+        if (listener >= 0)
+        {
+            close(listener);
+        }
+        return -1;
+    }
+    return listener;
+}
+
+/**
+    Function to connect to daemon
+    @param path : path of socket
+    @return socket, -1 if failed
+*/
+int trdConnect(const char *path)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0)
+    {
+        perror(path);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+/**
+    Function to remember connection touched by current batch
+    @param server : server
+    @param connection : touched connection
+*/
+void trServerTouch(TRServer *server, TRConnection *connection)
+{
+    if (connection->touched == 1)
+    {
+        return;
+    }
+    if (server->touchedSize == server->touchedCapacity)
+    {
+        server->touchedCapacity = server->touchedCapacity == 0 ? 64 : server->touchedCapacity * 2;
+        server->touched = (TRConnection**)realloc(server->touched, sizeof(TRConnection*) * server->touchedCapacity);
+    }
+    connection->touched = 1;
+    server->touched[server->touchedSize] = connection;
+    server->touchedSize += 1;
+}
+
+/**
+    Function to accept every waiting client
+    @param server : server
+*/
+void trServerAccept(TRServer *server)
+{
+    int fd = accept4(server->listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    while (fd >= 0)
+    {
+        TRConnection *connection = (TRConnection*)calloc(1, sizeof(TRConnection));
+        connection->fd = fd;
+
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = connection;
+        epoll_ctl(server->epoll, EPOLL_CTL_ADD, fd, &event);
+        fd = accept4(server->listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    }
+}
+
+/**
+    Function to read at most TRD_READ_BUDGET bytes client sent and add every complete request to batch,
+    epoll report connection again in next wake up if there is still something to read
+    @param server : server
+    @param connection : readable connection
+*/
+void trServerRead(TRServer *server, TRConnection *connection)
+{
+    trServerTouch(server, connection);
+    size_t budget = TRD_READ_BUDGET;
+    while (connection->closed == 0 && budget > 0)
+    {
+        if (connection->input.size + connection->output.size + TRD_READ_SIZE > TRD_MAX_BUFFERED || trBufferReserve(&connection->input, TRD_READ_SIZE) == 0)
+        {
+            connection->closed = 1;
+            break;
+        }
+        ssize_t received = recv(connection->fd, connection->input.data + connection->input.size, TRD_READ_SIZE, 0);
+        if (received > 0)
+        {
+            connection->input.size += received;
+            budget -= received < (ssize_t)budget ? (size_t)received : budget;
+        }
+        else if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        {
+            connection->closed = 1;
+        }
+        else if (errno != EINTR)
+        {
+            break;
+        }
+    }
+
+    // input is not moved until batch finished, so request only remember offset
+    while (connection->input.size - connection->parsed >= sizeof(TRRequestHeader))
+    {
+        TRRequestHeader header;
+        memcpy(&header, connection->input.data + connection->parsed, sizeof(header));
+        if (header.length > TRD_MAX_LENGTH)
+        {
+            connection->closed = 1;
+            break;
+        }
+        if (connection->input.size - connection->parsed < sizeof(header) + header.length)
+        {
+            break;
+        }
+
+        if (server->batchSize == server->batchCapacity)
+        {
+            server->batchCapacity = server->batchCapacity == 0 ? 256 : server->batchCapacity * 2;
+            server->batch = (TRPending*)realloc(server->batch, sizeof(TRPending) * server->batchCapacity);
+        }
+        TRPending *pending = &server->batch[server->batchSize];
+        pending->connection = connection;
+        pending->header = header;
+        pending->offset = connection->parsed + sizeof(header);
+        server->batchSize += 1;
+        connection->parsed += sizeof(header) + header.length;
+    }
+}
+
+/**
+    Function to compare request by rule so request of the same rule is matched together, request of
+    the same connection keep it's order
+    @param first : first request
+    @param second : second request
+    @return negative, zero or positive like strcmp
+*/
+int trPendingCompare(const void *first, const void *second)
+{
+    const TRPending *a = (const TRPending*)first;
+    const TRPending *b = (const TRPending*)second;
+    if (a->header.rule != b->header.rule)
+    {
+        return a->header.rule < b->header.rule ? -1 : 1;
+    }
+    if (a->connection != b->connection)
+    {
+        return (uintptr_t)a->connection < (uintptr_t)b->connection ? -1 : 1;
+    }
+    return (a->offset > b->offset) - (a->offset < b->offset);
+}
+
+/**
+    Function to match every request in batch, request is grouped by rule so each automaton is used
+    for many string while it's still in cache, request for any rule try every rule on all of them
+    @param server : server
+*/
+void trServerMatchBatch(TRServer *server)
+{
+    qsort(server->batch, server->batchSize, sizeof(TRPending), trPendingCompare);
+
+    int anyCount = 0;
+    for (int i = 0; i < server->batchSize; i++)
+    {
+        TRPending *pending = &server->batch[i];
+        const char *string = pending->connection->input.data + pending->offset;
+        if (pending->header.rule == TRD_ANY_RULE)
+        {
+            pending->result = -1;
+            anyCount += 1;
+        }
+        else if (pending->header.rule < 0 || pending->header.rule >= server->ruleCount)
+        {
+            pending->result = TRD_BAD_RULE;
+        }
+        else
+        {
+            pending->result = tRegexMatch(&server->rules[pending->header.rule], string, pending->header.length);
+        }
+    }
+
+    // TRD_ANY_RULE is the smallest valid rule, so they are at the start after bad rule
+    int first = 0;
+    while (first < server->batchSize && server->batch[first].header.rule < TRD_ANY_RULE)
+    {
+        first += 1;
+    }
+    for (int rule = 0; rule < server->ruleCount && anyCount > 0; rule++)
+    {
+        for (int i = first; i < first + anyCount; i++)
+        {
+            TRPending *pending = &server->batch[i];
+            if (pending->result < 0 && tRegexMatch(&server->rules[rule], pending->connection->input.data + pending->offset, pending->header.length) == MATCH)
+            {
+                pending->result = rule;
+            }
+        }
+    }
+
+    for (int i = 0; i < server->batchSize; i++)
+    {
+        TRResponse response;
+        response.id = server->batch[i].header.id;
+        response.result = server->batch[i].result;
+        if (trBufferAppend(&server->batch[i].connection->output, &response, sizeof(response)) == 0)
+        {
+            server->batch[i].connection->closed = 1;
+        }
+    }
+    server->batchSize = 0;
+}
+
+/**
+    Function to send response as much as socket accept, rest is sent when socket writable again
+    @param server : server
+    @param connection : connection to be flushed
+*/
+void trServerFlush(TRServer *server, TRConnection *connection)
+{
+    size_t sent = 0;
+    while (sent < connection->output.size)
+    {
+        ssize_t result = send(connection->fd, connection->output.data + sent, connection->output.size - sent, MSG_NOSIGNAL);
+        if (result > 0)
+        {
+            sent += result;
+        }
+        else if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                connection->closed = 1;
+                connection->output.size = sent;
+            }
+            break;
+        }
+    }
+    trBufferConsume(&connection->output, sent);
+
+    int writing = connection->output.size > 0;
+    if (writing != connection->writing && connection->closed == 0)
+    {
+        struct epoll_event event;
+        event.events = writing == 1 ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        event.data.ptr = connection;
+        epoll_ctl(server->epoll, EPOLL_CTL_MOD, connection->fd, &event);
+        connection->writing = writing;
+    }
+}
+
+/**
+    Function to free connection
+    @param connection : connection to be freed
+*/
+void trConnectionDelete(TRConnection *connection)
+{
+    close(connection->fd);
+    free(connection->input.data);
+    free(connection->output.data);
+    free(connection);
+}
+
+/**
+    Function to run event loop, every request read in one wake up become one batch, then every response
+    is sent and connection closed by client is freed
+    @param server : server with loaded rule
+    @param path : path of socket
+    @return 0 if stopped by signal, 1 if failed to start
+*/
+int trServerRun(TRServer *server, const char *path)
+{
+    server->listener = trdListen(path);
+    server->epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (server->listener < 0 || server->epoll < 0)
+    {
+        return 1;
+    }
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    epoll_ctl(server->epoll, EPOLL_CTL_ADD, server->listener, &event);
+
+    struct epoll_event events[TRD_MAX_EVENTS];
+    long batchCount = 0;
+    long requestCount = 0;
+    while (trdRunning == 1)
+    {
+        int ready = epoll_wait(server->epoll, events, TRD_MAX_EVENTS, -1);
+        for (int i = 0; i < ready; i++)
+        {
+            TRConnection *connection = (TRConnection*)events[i].data.ptr;
+            if (connection == NULL)
+            {
+                trServerAccept(server);
+                continue;
+            }
+            if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0)
+            {
+                trServerRead(server, connection);
+            }
+            if ((events[i].events & EPOLLOUT) != 0)
+            {
+                trServerTouch(server, connection);
+            }
+        }
+
+        if (server->batchSize > 0)
+        {
+            batchCount += 1;
+            requestCount += server->batchSize;
+            trServerMatchBatch(server);
+        }
+        for (int i = 0; i < server->touchedSize; i++)
+        {
+            TRConnection *connection = server->touched[i];
+            connection->touched = 0;
+            trBufferConsume(&connection->input, connection->parsed);
+            connection->parsed = 0;
+            trServerFlush(server, connection);
+            if (connection->closed == 1)
+            {
+                trConnectionDelete(connection);
+            }
+        }
+        server->touchedSize = 0;
+    }
+
+    fprintf(stderr, "tregexd: %ld request in %ld batch\n", requestCount, batchCount);
+    close(server->epoll);
+    close(server->listener);
+    unlink(path);
+    return 0;
+}
+
+/**
+    Function to send one request
+    @param fd : socket
+    @param id : id of request
+    @param rule : rule to be matched
+    @param string : string to be matched
+    @param length : length of string
+    @return 1 if sent, 0 if failed
+*/
+int trdSendRequest(int fd, uint32_t id, int32_t rule, const char *string, uint32_t length)
+{
+    TRRequestHeader header;
+    header.length = length;
+    header.id = id;
+    header.rule = rule;
+    return send(fd, &header, sizeof(header), MSG_NOSIGNAL) == sizeof(header) && send(fd, string, length, MSG_NOSIGNAL) == (ssize_t)length;
+}
+
+/**
+    Function to read exactly size bytes
+    @param fd : socket
+    @param data : buffer for received bytes
+    @param size : number of bytes
+    @return 1 if received, 0 if connection closed
+*/
+int trdReceive(int fd, void *data, size_t size)
+{
+    size_t received = 0;
+    while (received < size)
+    {
+        ssize_t result = recv(fd, (char*)data + received, size - received, 0);
+        if (result <= 0 && !(result < 0 && errno == EINTR))
+        {
+            return 0;
+        }
+        received += result > 0 ? result : 0;
+    }
+    return 1;
+}
+
+/**
+    Function to send one request and print the result
+    @param path : path of socket
+    @param rule : rule to be matched
+    @param string : string to be matched
+    @return 0 if matched, 1 if not matched, 2 if failed
+*/
+int trdClient(const char *path, int rule, const char *string)
+{
+    int fd = trdConnect(path);
+    TRResponse response;
+    if (fd < 0 || trdSendRequest(fd, 1, rule, string, strlen(string)) == 0 || trdReceive(fd, &response, sizeof(response)) == 0)
+    {
+        fprintf(stderr, "tregexd: request failed\n");
+        return 2;
+    }
+    close(fd);
+
+    if (response.result == TRD_BAD_RULE)
+    {
+        printf("rule %d doesn't exist\n", rule);
+        return 2;
+    }
+    if (rule == TRD_ANY_RULE)
+    {
+        printf(response.result >= 0 ? "rule %d\n" : "no rule\n", response.result);
+        return response.result >= 0 ? 0 : 1;
+    }
+    printf("%s\n", response.result == MATCH ? "MATCH" : "NO_MATCH");
+    return response.result == MATCH ? 0 : 1;
+}
+
+/**
+    Function to generate load, every connection keep pipeline request in flight until it sent all of
+    it's request, then print throughput, latency and number of response that matched
+    @param path : path of socket
+    @param rule : rule to be matched
+    @param string : string to be matched
+    @param connectionCount : number of connection
+    @param requestCount : request sent by each connection
+    @param pipeline : request in flight for each connection
+    @return 0 if every response received, 2 if failed
+*/
+int trdBench(const char *path, int rule, const char *string, int connectionCount, int requestCount, int pipeline)
+{
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    int *fds = (int*)malloc(sizeof(int) * connectionCount);
+    int *sent = (int*)calloc(connectionCount, sizeof(int));
+    int *received = (int*)calloc(connectionCount, sizeof(int));
+    double *sendTime = (double*)malloc(sizeof(double) * connectionCount * pipeline);
+    uint32_t length = strlen(string);
+    double totalLatency = 0;
+    long matchCount = 0;
+    int failed = 0;
+
+    for (int i = 0; i < connectionCount; i++)
+    {
+        fds[i] = trdConnect(path);
+        if (fds[i] < 0)
+        {
+            return 2;
+        }
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u32 = i;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, fds[i], &event);
+    }
+
+    double start = trdNow();
+    for (int i = 0; i < connectionCount; i++)
+    {
+        while (sent[i] < requestCount && sent[i] < pipeline)
+        {
+            sendTime[i * pipeline + sent[i] % pipeline] = trdNow();
+            failed |= trdSendRequest(fds[i], sent[i], rule, string, length) == 0;
+            sent[i] += 1;
+        }
+    }
+
+    int finished = 0;
+    struct epoll_event events[TRD_MAX_EVENTS];
+    while (finished < connectionCount && failed == 0)
+    {
+        int ready = epoll_wait(epoll, events, TRD_MAX_EVENTS, -1);
+        for (int e = 0; e < ready; e++)
+        {
+            int i = events[e].data.u32;
+            TRResponse response;
+            if (trdReceive(fds[i], &response, sizeof(response)) == 0)
+            {
+                failed = 1;
+                break;
+            }
+            totalLatency += trdNow() - sendTime[i * pipeline + response.id % pipeline];
+            received[i] += 1;
+            matchCount += rule == TRD_ANY_RULE ? response.result >= 0 : response.result == MATCH;
+            if (sent[i] < requestCount)
+            {
+                sendTime[i * pipeline + sent[i] % pipeline] = trdNow();
+                failed |= trdSendRequest(fds[i], sent[i], rule, string, length) == 0;
+                sent[i] += 1;
+            }
+            finished += received[i] == requestCount;
+        }
+    }
+    double elapsed = trdNow() - start;
+
+    long total = (long)connectionCount * requestCount;
+    if (failed == 0)
+    {
+        printf("%ld request in %.3f s, %.0f request/s, average latency %.1f us, %ld matched\n", total, elapsed, total / elapsed, totalLatency / total * 1e6, matchCount);
+    }
+    for (int i = 0; i < connectionCount; i++)
+    {
+        close(fds[i]);
+    }
+    close(epoll);
+    free(sendTime);
+    free(received);
+    free(sent);
+    free(fds);
+    return failed == 1 ? 2 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 4 && strcmp(argv[1], "serve") == 0)
+    {
+        TRServer server;
+        memset(&server, 0, sizeof(server));
+        long threadCount = argc >= 5 ? atol(argv[4]) : sysconf(_SC_NPROCESSORS_ONLN);
+        if (trServerLoadRules(&server, argv[3], (int)threadCount) == 0)
+        {
+            return 1;
+        }
+        fprintf(stderr, "tregexd: %d rule loaded, listening on %s\n", server.ruleCount, argv[2]);
+
+        signal(SIGINT, trdStop);
+        signal(SIGTERM, trdStop);
+        int result = trServerRun(&server, argv[2]);
+        for (int i = 0; i < server.ruleCount; i++)
+        {
+            tRegexSetCode(&server.rules[i], "");
+            trDArrayDelete(server.rules[i].startingState);
+        }
+        tRegexArenaDelete(&server.arena);
+        free(server.rules);
+        free(server.batch);
+        free(server.touched);
+        return result;
+    }
+    if (argc == 5 && strcmp(argv[1], "client") == 0)
+    {
+        return trdClient(argv[2], atoi(argv[3]), argv[4]);
+    }
+    if (argc >= 5 && strcmp(argv[1], "bench") == 0)
+    {
+        int connectionCount = argc >= 6 ? atoi(argv[5]) : 4;
+        int requestCount = argc >= 7 ? atoi(argv[6]) : 100000;
+        int pipeline = argc >= 8 ? atoi(argv[7]) : 16;
+        return trdBench(argv[2], atoi(argv[3]), argv[4], connectionCount, requestCount, pipeline);
+    }
+
+    fprintf(stderr, "usage:\n");
+    fprintf(stderr, "    %s serve <socket path> <rule file> [thread]\n", argv[0]);
+    fprintf(stderr, "    %s client <socket path> <rule, -1 for any> <string>\n", argv[0]);
+    fprintf(stderr, "    %s bench <socket path> <rule, -1 for any> <string> [connection] [request per connection] [pipeline]\n", argv[0]);
+    return 2;
+}
+#else
+int main()
+{
+    fprintf(stderr, "tregexd needs epoll, only Linux is supported\n");
+    return 2;
+}
+#endif
@@ -0,0 +1,71 @@
+#!/bin/sh
+# Start tregexd with small rule file and check reply of client and bench
+# usage: sh tregexd_test.sh
+
+dir=$(mktemp -d)
+socket="$dir/tregexd.sock"
+failed=0
+
+cleanup()
+{
+    if [ -n "$server" ]; then
+        kill "$server" 2>/dev/null
+        wait "$server" 2>/dev/null
+    fi
+    rm -rf "$dir"
+}
+trap cleanup EXIT
+
+check()
+{
+    if [ "$2" = "$3" ]; then
+        echo "True"
+    else
+        echo "False ($1: expected \"$3\", got \"$2\")"
+        failed=1
+    fi
+}
+
+gcc -O2 -o "$dir/tregexd" "$(dirname "$0")/tregexd.c" -pthread || exit 1
+
+cat > "$dir/rules.txt" <<'EOF'
+\w+@gmail\.com
+\d+
+
+(ab)*c
+EOF
+
+"$dir/tregexd" serve "$socket" "$dir/rules.txt" 2 2>"$dir/serve.log" &
+server=$!
+tries=0
+while [ ! -S "$socket" ] && [ $tries -lt 50 ]; do
+    sleep 0.1
+    tries=$((tries + 1))
+done
+
+check "rule 0" "$("$dir/tregexd" client "$socket" 0 "hans@gmail.com")" "MATCH"
+check "rule 0" "$("$dir/tregexd" client "$socket" 0 "hans@yahoo.com")" "NO_MATCH"
+check "rule 1" "$("$dir/tregexd" client "$socket" 1 "12345")" "MATCH"
+check "rule 2" "$("$dir/tregexd" client "$socket" 2 "ababc")" "MATCH"
+check "rule 2" "$("$dir/tregexd" client "$socket" 2 "abac")" "NO_MATCH"
+check "any rule" "$("$dir/tregexd" client "$socket" -1 "hans@gmail.com")" "rule 0"
+check "any rule" "$("$dir/tregexd" client "$socket" -1 "2024")" "rule 1"
+check "any rule" "$("$dir/tregexd" client "$socket" -1 "abc")" "rule 2"
+check "any rule" "$("$dir/tregexd" client "$socket" -1 "hello")" "no rule"
+check "bad rule" "$("$dir/tregexd" client "$socket" 3 "abc")" "rule 3 doesn't exist"
+
+# every response of bench must be counted and agree with client
+bench=$("$dir/tregexd" bench "$socket" 0 "hans@gmail.com" 8 2000 32)
+check "bench" "$?" "0"
+check "bench" "${bench%% in *} ${bench##*, }" "16000 request 16000 matched"
+bench=$("$dir/tregexd" bench "$socket" 1 "12a" 4 1000 256)
+check "bench" "$?" "0"
+check "bench" "${bench%% in *} ${bench##*, }" "4000 request 0 matched"
+bench=$("$dir/tregexd" bench "$socket" -1 "abc" 4 1000 256)
+check "bench" "$?" "0"
+check "bench" "${bench%% in *} ${bench##*, }" "4000 request 4000 matched"
+
+# daemon still serve new client after bench
+check "after bench" "$("$dir/tregexd" client "$socket" 1 "7")" "MATCH"
+
+exit $failed